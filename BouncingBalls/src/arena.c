@@ -0,0 +1,152 @@
+/*
+ * Frame arena: bump allocation over one block, reset once per frame.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include "arena.h"
+
+struct arena {
+    unsigned char *base;
+    size_t capacity;
+    size_t used;
+    size_t demand;      /* Bytes in use if no request had been refused */
+    size_t peak;        /* Largest demand since the last reset */
+    size_t highwater;
+    long overflows;
+};
+
+/* Return a newly created arena holding capacity bytes. */
+arena_t *arena_create(size_t capacity)
+{
+    arena_t *arena = malloc(sizeof(*arena));
+
+    if (!arena) {
+        return NULL;
+    }
+
+    arena->base = malloc(capacity);
+    if (!arena->base) {
+        free(arena);
+        return NULL;
+    }
+
+    arena->capacity = capacity;
+    arena->used = 0;
+    arena->demand = 0;
+    arena->peak = 0;
+    arena->highwater = 0;
+    arena->overflows = 0;
+
+    return arena;
+}
+
+/* Free the arena and its memory. */
+void arena_destroy(arena_t *arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    free(arena->base);
+    free(arena);
+}
+
+/* Bump-allocate size bytes at the requested alignment. */
+void *arena_alloc(arena_t *arena, size_t size, size_t align)
+{
+    uintptr_t start, offset;
+
+    if (!arena) {
+        return NULL;
+    }
+    if (align == 0) {
+        align = 1;
+    }
+
+    /* Align the address itself, so alignment beyond malloc's also works. */
+    start = (uintptr_t)(arena->base + arena->used);
+    offset = ((start + align - 1) & ~(uintptr_t)(align - 1)) - (uintptr_t)arena->base;
+
+    if (offset + size > arena->capacity) {
+        arena->demand += size + align - 1;
+        if (arena->demand > arena->peak) {
+            arena->peak = arena->demand;
+        }
+        arena->overflows++;
+        return NULL;
+    }
+
+    arena->demand += offset + size - arena->used;
+    if (arena->demand > arena->peak) {
+        arena->peak = arena->demand;
+    }
+    arena->used = offset + size;
+    if (arena->used > arena->highwater) {
+        arena->highwater = arena->used;
+    }
+
+    return arena->base + offset;
+}
+
+/* Return the current position. */
+arena_mark_t arena_mark(arena_t *arena)
+{
+    arena_mark_t mark = { 0, 0 };
+
+    if (arena) {
+        mark.used = arena->used;
+        mark.demand = arena->demand;
+    }
+
+    return mark;
+}
+
+/* Release the allocations made since mark; the peak demand is kept. */
+void arena_rewind(arena_t *arena, arena_mark_t mark)
+{
+    if (!arena || mark.used > arena->used) {
+        return;
+    }
+
+    arena->used = mark.used;
+    arena->demand = mark.demand;
+}
+
+/* Release all allocations, growing first if the last frame did not fit. */
+void arena_reset(arena_t *arena)
+{
+    unsigned char *base;
+    size_t capacity;
+
+    if (!arena) {
+        return;
+    }
+
+    if (arena->peak > arena->capacity) {
+        /* Leave headroom so a slowly growing scene does not regrow every frame. */
+        capacity = arena->peak + arena->peak / 2;
+        base = malloc(capacity);
+        if (base) {
+            free(arena->base);
+            arena->base = base;
+            arena->capacity = capacity;
+        }
+    }
+
+    arena->used = 0;
+    arena->demand = 0;
+    arena->peak = 0;
+}
+
+/* Copy the current arena statistics. */
+void arena_getstats(arena_t *arena, arena_stats_t *stats)
+{
+    if (!arena || !stats) {
+        return;
+    }
+
+    stats->capacity = arena->capacity;
+    stats->used = arena->used;
+    stats->highwater = arena->highwater;
+    stats->overflows = arena->overflows;
+}
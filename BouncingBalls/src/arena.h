@@ -0,0 +1,75 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+
+/*
+ * Frame arena interface
+ *
+ * A linear allocator for data that only lives until the end of a frame.
+ * Allocation bumps a pointer; nothing is freed individually, the whole
+ * arena is reset at the top of the next frame instead. Scratch that is
+ * done with sooner can be given back by rewinding to a mark taken before
+ * it was allocated. The arena never grows in the middle of a frame:
+ * requests that do not fit return NULL and are remembered, and the next
+ * reset grows the arena so they fit from then on.
+ */
+
+struct arena;
+typedef struct arena arena_t;
+
+typedef struct arena_stats arena_stats_t;
+
+struct arena_stats {
+    size_t capacity;    /* Bytes the arena can hand out per frame */
+    size_t used;        /* Bytes handed out since the last reset */
+    size_t highwater;   /* Most bytes ever handed out in a single frame */
+    long   overflows;   /* Requests refused because the arena was full */
+};
+
+typedef struct arena_mark arena_mark_t;
+
+/* Position in an arena to rewind to; only valid until the next reset */
+struct arena_mark {
+    size_t used;
+    size_t demand;
+};
+
+/*
+ * Return a newly created arena holding capacity bytes.
+ */
+arena_t *arena_create(size_t capacity);
+
+/*
+ * Free the arena and its memory.
+ */
+void arena_destroy(arena_t *arena);
+
+/*
+ * Return size bytes aligned to align (a power of two), or NULL if they do not fit.
+ */
+void *arena_alloc(arena_t *arena, size_t size, size_t align);
+
+/*
+ * Return the arena's current position, to be passed to arena_rewind.
+ */
+arena_mark_t arena_mark(arena_t *arena);
+
+/*
+ * Release everything allocated since mark was taken. Requests refused since
+ * then still count towards the growth at the next reset.
+ */
+void arena_rewind(arena_t *arena, arena_mark_t mark);
+
+/*
+ * Release everything allocated since the last reset. If the arena ran out
+ * of space, it is first grown to fit that frame's largest demand.
+ */
+void arena_reset(arena_t *arena);
+
+/*
+ * Copy the current arena statistics into stats.
+ */
+void arena_getstats(arena_t *arena, arena_stats_t *stats);
+
+#endif /*ARENA_H_*/
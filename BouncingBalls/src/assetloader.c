@@ -0,0 +1,264 @@
+/*
+ * Asynchronous asset loader: a worker thread and two lock-free SPSC queues.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <SDL2/SDL.h>
+#include "model.h"
+#include "import.h"
+#include "assetloader.h"
+#include "trace.h"
+
+/* One load request, handed to the worker and back again */
+typedef struct assetjob assetjob_t;
+
+struct assetjob {
+    char            *path;
+    model_t         *placeholder;   /* Model returned to the requester */
+    model_t         *result;        /* Model loaded by the worker, or NULL */
+    asset_readyfn_t callback;
+    void            *arg;
+};
+
+/*
+ * Single-producer, single-consumer ring of jobs. Only the producer writes
+ * tail and only the consumer writes head, so no lock is needed; the slot
+ * is written before tail is published and read before head is released.
+ */
+typedef struct jobqueue jobqueue_t;
+
+struct jobqueue {
+    assetjob_t      *slots[ASSETLOADER_MAXPENDING];
+    SDL_atomic_t    head;   /* Next slot to pop */
+    SDL_atomic_t    tail;   /* Next slot to push */
+};
+
+struct assetloader {
+    jobqueue_t      requests;       /* Main thread to worker */
+    jobqueue_t      completions;    /* Worker to main thread */
+    SDL_sem         *wakeup;        /* Posted once per request, and on shutdown */
+    SDL_atomic_t    quit;
+    SDL_Thread      *worker;
+    int             pending;        /* Requests not yet polled; main thread only */
+};
+
+/* Push a job; the caller guarantees there is room. */
+static void queue_push(jobqueue_t *queue, assetjob_t *job)
+{
+    int tail = SDL_AtomicGet(&queue->tail);
+
+    queue->slots[tail % ASSETLOADER_MAXPENDING] = job;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->tail, tail + 1);
+}
+
+/* Pop a job, or return NULL if the queue is empty. */
+static assetjob_t *queue_pop(jobqueue_t *queue)
+{
+    int head = SDL_AtomicGet(&queue->head);
+    assetjob_t *job;
+
+    if (head == SDL_AtomicGet(&queue->tail)) {
+        return NULL;
+    }
+
+    SDL_MemoryBarrierAcquire();
+    job = queue->slots[head % ASSETLOADER_MAXPENDING];
+    SDL_AtomicSet(&queue->head, head + 1);
+
+    return job;
+}
+
+/* Touch every page of a mapped model so the main thread never faults on it. */
+static void prefault(model_t *model)
+{
+    volatile const unsigned char *bytes = model->mapping;
+    long pagesize = sysconf(_SC_PAGESIZE);
+    unsigned int sum = 0;
+    size_t offset;
+
+    if (pagesize <= 0) {
+        pagesize = 4096;
+    }
+    for (offset = 0; offset < model->mappingsize; offset += (size_t)pagesize) {
+        sum += bytes[offset];
+    }
+    (void)sum;
+}
+
+/* Load one file on the worker thread. */
+static model_t *load(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+    model_t *model;
+
+    if (ext && strcasecmp(ext, ".bbm") == 0) {
+        model = model_load(path);
+        if (model) {
+            prefault(model);
+        }
+        return model;
+    }
+
+    return import_model(path);
+}
+
+/* Worker thread: load requests until told to quit. */
+static int worker_main(void *data)
+{
+    assetloader_t *loader = data;
+    assetjob_t *job;
+
+    trace_threadname("assetloader");
+
+    for (;;) {
+        SDL_SemWait(loader->wakeup);
+
+        /* Drain requests before honouring quit, so every job comes back. */
+        while ((job = queue_pop(&loader->requests)) != NULL) {
+            TRACE_BEGIN(start);
+            job->result = load(job->path);
+            TRACE_END("load model", start);
+            queue_push(&loader->completions, job);
+        }
+
+        if (SDL_AtomicGet(&loader->quit)) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/* Return a newly created loader with its worker thread running. */
+assetloader_t *assetloader_create(void)
+{
+    assetloader_t *loader = calloc(1, sizeof(*loader));
+
+    if (!loader) {
+        return NULL;
+    }
+
+    loader->wakeup = SDL_CreateSemaphore(0);
+    if (!loader->wakeup) {
+        free(loader);
+        return NULL;
+    }
+
+    loader->worker = SDL_CreateThread(worker_main, "assetloader", loader);
+    if (!loader->worker) {
+        SDL_DestroySemaphore(loader->wakeup);
+        free(loader);
+        return NULL;
+    }
+
+    return loader;
+}
+
+/* Finish outstanding loads, stop the worker and free the loader. */
+void assetloader_destroy(assetloader_t *loader)
+{
+    if (!loader) {
+        return;
+    }
+
+    SDL_AtomicSet(&loader->quit, 1);
+    SDL_SemPost(loader->wakeup);
+    SDL_WaitThread(loader->worker, NULL);
+
+    /* The worker drained every request, so this applies all of them. */
+    assetloader_poll(loader);
+
+    SDL_DestroySemaphore(loader->wakeup);
+    free(loader);
+}
+
+/* Queue path for loading and return its placeholder model. */
+model_t *assetloader_request(assetloader_t *loader, const char *path,
+                             asset_readyfn_t callback, void *arg)
+{
+    assetjob_t *job;
+    model_t *placeholder;
+
+    if (!loader || !path) {
+        return NULL;
+    }
+
+    /* Bounding requests in flight also keeps the completion queue from overflowing. */
+    if (loader->pending == ASSETLOADER_MAXPENDING) {
+        fprintf(stderr, "Asset loader queue is full; cannot load %s\n", path);
+        return NULL;
+    }
+
+    job = malloc(sizeof(*job));
+    placeholder = calloc(1, sizeof(*placeholder));
+    if (!job || !placeholder) {
+        free(job);
+        free(placeholder);
+        return NULL;
+    }
+
+    job->path = strdup(path);
+    if (!job->path) {
+        free(job);
+        free(placeholder);
+        return NULL;
+    }
+
+    placeholder->flags = MODEL_LOADING;
+    job->placeholder = placeholder;
+    job->result = NULL;
+    job->callback = callback;
+    job->arg = arg;
+
+    loader->pending++;
+    queue_push(&loader->requests, job);
+    SDL_SemPost(loader->wakeup);
+
+    return placeholder;
+}
+
+/* Apply all finished loads and run their callbacks. */
+int assetloader_poll(assetloader_t *loader)
+{
+    assetjob_t *job;
+    int applied = 0;
+
+    if (!loader) {
+        return 0;
+    }
+
+    while ((job = queue_pop(&loader->completions)) != NULL) {
+        model_t *placeholder = job->placeholder;
+
+        if (job->result) {
+            /* Objects hold the placeholder pointer, so the result moves into it. */
+            *placeholder = *job->result;
+            placeholder->flags &= ~MODEL_LOADING;
+            free(job->result);
+        } else {
+            /* The loader already said why; the callback decides what it means */
+            placeholder->flags = MODEL_FAILED;
+        }
+
+        if (job->callback) {
+            job->callback(placeholder, job->result != NULL, job->arg);
+        }
+
+        loader->pending--;
+        applied++;
+        free(job->path);
+        free(job);
+    }
+
+    return applied;
+}
+
+/* Return the number of requests not yet applied. */
+int assetloader_pending(assetloader_t *loader)
+{
+    return loader ? loader->pending : 0;
+}
@@ -0,0 +1,61 @@
+#ifndef ASSETLOADER_H_
+#define ASSETLOADER_H_
+
+#include "model.h"
+
+/*
+ * Asynchronous asset loader interface
+ *
+ * A worker thread loads and decodes model files off the main thread.
+ * A request immediately returns a placeholder model flagged MODEL_LOADING
+ * that objects can be created with; it has no triangles yet. The worker
+ * publishes finished loads through a lock-free single-producer,
+ * single-consumer queue, and assetloader_poll, called once per frame on
+ * the main thread, moves each result into its placeholder and runs the
+ * ready callback. Models therefore only ever change on the main thread.
+ */
+
+struct assetloader;
+typedef struct assetloader assetloader_t;
+
+/* Maximum number of requests in flight at once */
+#define ASSETLOADER_MAXPENDING  64
+
+/*
+ * Called on the main thread when a requested model has finished loading.
+ * ok is 1 on success, 0 if the model is flagged MODEL_FAILED instead.
+ */
+typedef void (*asset_readyfn_t)(model_t *model, int ok, void *arg);
+
+/*
+ * Return a newly created loader with its worker thread running.
+ */
+assetloader_t *assetloader_create(void);
+
+/*
+ * Finish outstanding loads, stop the worker and free the loader. Results
+ * still queued are applied and their callbacks run. The returned models
+ * are owned by the caller and must still be freed with model_destroy.
+ */
+void assetloader_destroy(assetloader_t *loader);
+
+/*
+ * Queue path for loading and return its placeholder model, or NULL if the
+ * queue is full. Model files (.bbm) are mapped and paged in; OBJ and STL
+ * meshes are imported. callback may be NULL.
+ */
+model_t *assetloader_request(assetloader_t *loader, const char *path,
+                             asset_readyfn_t callback, void *arg);
+
+/*
+ * Apply all finished loads and run their callbacks. Call once per frame
+ * from the main thread. Returns the number of loads applied.
+ */
+int assetloader_poll(assetloader_t *loader);
+
+/*
+ * Return the number of requests that have not yet been applied by a poll.
+ */
+int assetloader_pending(assetloader_t *loader);
+
+#endif /*ASSETLOADER_H_*/
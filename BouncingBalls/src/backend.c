@@ -0,0 +1,160 @@
+/*
+ * Backend module: window and headless (offscreen) frame targets.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "backend.h"
+
+struct backend {
+    int             type;
+    SDL_Window      *window;    /* Window backend only */
+    SDL_Surface     *surface;   /* Window surface, or the offscreen framebuffer */
+    unsigned int    ticks;      /* Headless frame clock in ms */
+};
+
+/* Open the window and fetch its surface. */
+static int window_open(backend_t *backend, int width, int height, const char *title)
+{
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        fprintf(stderr, "Unable to initialize SDL. Error returned: %s\n", SDL_GetError());
+        return 0;
+    }
+
+    backend->window = SDL_CreateWindow(title,
+                                       SDL_WINDOWPOS_UNDEFINED,
+                                       SDL_WINDOWPOS_UNDEFINED,
+                                       width, height,
+                                       0);
+    if (!backend->window) {
+        fprintf(stderr, "Unable to create window. Error returned: %s\n", SDL_GetError());
+        return 0;
+    }
+
+    backend->surface = SDL_GetWindowSurface(backend->window);
+    if (!backend->surface) {
+        fprintf(stderr, "Unable to get window surface. Error returned: %s\n", SDL_GetError());
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Create the offscreen framebuffer; only the timer subsystem is needed. */
+static int headless_open(backend_t *backend, int width, int height)
+{
+    if (SDL_Init(SDL_INIT_TIMER) < 0) {
+        fprintf(stderr, "Unable to initialize SDL. Error returned: %s\n", SDL_GetError());
+        return 0;
+    }
+
+    backend->surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!backend->surface) {
+        fprintf(stderr, "Unable to create offscreen surface. Error returned: %s\n", SDL_GetError());
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Initialize SDL and return a newly created backend. */
+backend_t *backend_create(int type, int width, int height, const char *title)
+{
+    backend_t *backend;
+    int ok;
+
+    if (width <= 0 || height <= 0 ||
+        (type != BACKEND_WINDOW && type != BACKEND_HEADLESS)) {
+        return NULL;
+    }
+
+    backend = calloc(1, sizeof(*backend));
+    if (!backend) {
+        return NULL;
+    }
+    backend->type = type;
+
+    if (type == BACKEND_WINDOW) {
+        ok = window_open(backend, width, height, title);
+    } else {
+        ok = headless_open(backend, width, height);
+    }
+    if (!ok) {
+        backend_destroy(backend);
+        return NULL;
+    }
+
+    return backend;
+}
+
+/* Destroy the backend and shut down SDL. */
+void backend_destroy(backend_t *backend)
+{
+    if (!backend) {
+        return;
+    }
+
+    if (backend->window) {
+        /* The window owns its surface */
+        SDL_DestroyWindow(backend->window);
+    } else if (backend->surface) {
+        SDL_FreeSurface(backend->surface);
+    }
+    free(backend);
+
+    SDL_Quit();
+}
+
+/* Return the backend type. */
+int backend_type(backend_t *backend)
+{
+    return backend->type;
+}
+
+/* Return the surface to draw the next frame into. */
+SDL_Surface *backend_surface(backend_t *backend)
+{
+    return backend->surface;
+}
+
+/* Handle pending input; there is none without a window. */
+int backend_poll(backend_t *backend)
+{
+    SDL_Event e;
+    int running = 1;
+
+    if (backend->type == BACKEND_HEADLESS) {
+        return 1;
+    }
+
+    while (SDL_PollEvent(&e)) {
+        if (e.type == SDL_QUIT)
+            running = 0;
+        if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)
+            running = 0;
+    }
+
+    return running;
+}
+
+/* Return the current frame time in ms. */
+unsigned int backend_ticks(backend_t *backend)
+{
+    if (backend->type == BACKEND_HEADLESS) {
+        return backend->ticks;
+    }
+
+    return SDL_GetTicks();
+}
+
+/* Present the finished frame and advance to the next one. */
+void backend_present(backend_t *backend)
+{
+    if (backend->type == BACKEND_HEADLESS) {
+        backend->ticks += BACKEND_FRAMETIME;
+        return;
+    }
+
+    SDL_UpdateWindowSurface(backend->window);
+    SDL_Delay(1);
+}
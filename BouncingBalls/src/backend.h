@@ -0,0 +1,63 @@
+#ifndef BACKEND_H_
+#define BACKEND_H_
+
+#include <SDL2/SDL.h>
+
+/*
+ * Display backend interface
+ *
+ * A backend owns SDL, the surface frames are drawn into, input and the
+ * frame clock. The window backend shows frames in an SDL window and runs
+ * on wall-clock time. The headless backend draws into an offscreen
+ * surface, needs no display, and advances its clock by a fixed step per
+ * presented frame, so a run renders the same frames however fast the host is.
+ */
+
+struct backend;
+typedef struct backend backend_t;
+
+/* Backend types */
+#define BACKEND_WINDOW      0
+#define BACKEND_HEADLESS    1
+
+/* Simulated time between frames on the headless backend, in ms */
+#define BACKEND_FRAMETIME   16
+
+/*
+ * Initialize SDL and return a newly created backend of the given type with
+ * a width x height surface. title is only used by the window backend.
+ * Returns NULL on error.
+ */
+backend_t *backend_create(int type, int width, int height, const char *title);
+
+/*
+ * Destroy the backend and shut down SDL.
+ */
+void backend_destroy(backend_t *backend);
+
+/*
+ * Return the backend type.
+ */
+int backend_type(backend_t *backend);
+
+/*
+ * Return the surface to draw the next frame into.
+ */
+SDL_Surface *backend_surface(backend_t *backend);
+
+/*
+ * Handle pending input. Returns 0 if the user asked to quit, 1 otherwise.
+ */
+int backend_poll(backend_t *backend);
+
+/*
+ * Return the current frame time in ms.
+ */
+unsigned int backend_ticks(backend_t *backend);
+
+/*
+ * Present the finished frame and advance to the next one.
+ */
+void backend_present(backend_t *backend);
+
+#endif /*BACKEND_H_*/
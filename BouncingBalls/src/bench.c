@@ -0,0 +1,570 @@
+/*
+ * Microbenchmark suite: lines, triangles, objects, list operations and the
+ * physics step, each over a range of parameters.
+ *
+ * Every case is calibrated to run in batches of at least BENCH_BATCHMS,
+ * warmed up for BENCH_WARMUP batches and then timed for a number of
+ * repetitions. The median time per operation and its median absolute
+ * deviation (MAD) are printed and written as JSON for regression tracking.
+ *
+ * Usage: microbench [--json FILE] [--reps N] [--filter TEXT]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "drawline.h"
+#include "disc.h"
+#include "triangle.h"
+#include "model.h"
+#include "object.h"
+#include "physics.h"
+#include "list.h"
+
+#define BENCH_BATCHMS   20.0    /* Minimum time per timed batch */
+#define BENCH_WARMUP    2       /* Untimed batches before measuring */
+#define BENCH_REPS      11      /* Default number of timed batches */
+#define BENCH_MAXCASES  128
+#define BENCH_MAXREPS   101
+
+#define SURFACE_SIZE    1024
+
+/* Work done once per iteration of a case */
+typedef void (*benchfn_t)(void *arg, long iterations);
+
+typedef struct benchresult benchresult_t;
+
+struct benchresult {
+    char    name[32];
+    char    params[64];
+    long    iterations;     /* Iterations per timed batch */
+    double  median;         /* ns per operation */
+    double  mad;
+};
+
+static benchresult_t results[BENCH_MAXCASES];
+static int numresults;
+static int numreps = BENCH_REPS;
+static const char *filter = NULL;
+static double tickns;
+
+static SDL_Surface *surface;
+
+/* qsort comparator for doubles. */
+static int compare_double(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
+
+/* Return the median of n values, reordering them. */
+static double median(double *values, int n)
+{
+    qsort(values, n, sizeof(double), compare_double);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+/* Return the time in ns that fn takes for the given number of iterations. */
+static double time_batch(benchfn_t fn, void *arg, long iterations)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    fn(arg, iterations);
+    return (double)(SDL_GetPerformanceCounter() - start) * tickns;
+}
+
+/*
+ * Measure one case. ops is the number of operations one iteration
+ * performs, so results are reported per line, per triangle, per ball.
+ */
+static void measure(const char *name, const char *params, long ops, benchfn_t fn, void *arg)
+{
+    double samples[BENCH_MAXREPS], deviations[BENCH_MAXREPS];
+    benchresult_t *result;
+    long iterations = 1;
+    double ns;
+    int i;
+
+    if (filter && !strstr(name, filter) && !strstr(params, filter)) {
+        return;
+    }
+    if (numresults == BENCH_MAXCASES) {
+        fprintf(stderr, "Too many benchmark cases\n");
+        return;
+    }
+
+    /* Double the batch until it is long enough to time reliably */
+    while ((ns = time_batch(fn, arg, iterations)) < BENCH_BATCHMS * 1e6 && iterations < (1L << 40)) {
+        iterations *= 2;
+    }
+    for (i = 0; i < BENCH_WARMUP; i++) {
+        time_batch(fn, arg, iterations);
+    }
+
+    for (i = 0; i < numreps; i++) {
+        samples[i] = time_batch(fn, arg, iterations) / ((double)iterations * ops);
+    }
+
+    result = &results[numresults++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    snprintf(result->params, sizeof(result->params), "%s", params);
+    result->iterations = iterations;
+    result->median = median(samples, numreps);
+    for (i = 0; i < numreps; i++) {
+        deviations[i] = samples[i] > result->median ? samples[i] - result->median
+                                                    : result->median - samples[i];
+    }
+    result->mad = median(deviations, numreps);
+
+    printf("%-12s %-32s %12.2f ns/op  +- %8.2f\n", name, params, result->median, result->mad);
+    fflush(stdout);
+}
+
+/* Write all results as JSON. */
+static int write_json(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    int i;
+
+    if (!file) {
+        fprintf(stderr, "Unable to create %s\n", path);
+        return 0;
+    }
+
+    fprintf(file, "{\n  \"unit\": \"ns/op\",\n  \"reps\": %d,\n  \"benchmarks\": [\n", numreps);
+    for (i = 0; i < numresults; i++) {
+        fprintf(file, "    {\"name\": \"%s\", \"params\": \"%s\", \"iterations\": %ld, "
+                "\"median\": %.3f, \"mad\": %.3f}%s\n",
+                results[i].name, results[i].params, results[i].iterations,
+                results[i].median, results[i].mad, i + 1 < numresults ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    return fclose(file) == 0;
+}
+
+/*
+ * Lines
+ */
+
+typedef struct linecase linecase_t;
+
+struct linecase {
+    const char  *slope;
+    int         dx, dy;
+};
+
+static void run_line(void *arg, long iterations)
+{
+    const linecase_t *line = arg;
+    int cx = SURFACE_SIZE / 2, cy = SURFACE_SIZE / 2;
+    long i;
+
+    for (i = 0; i < iterations; i++) {
+        draw_line(surface, cx, cy, cx + line->dx, cy + line->dy, 0x00ffffff);
+    }
+}
+
+static void bench_lines(void)
+{
+    static linecase_t lines[] = {
+        { "horizontal", 256, 0 },
+        { "vertical", 0, 256 },
+        { "diagonal", 256, 256 },
+        { "shallow", 256, 64 },
+        { "steep", 64, 256 },
+        { "backward", -256, -100 },
+    };
+    char params[64];
+    int i;
+
+    for (i = 0; i < (int)(sizeof(lines) / sizeof(lines[0])); i++) {
+        snprintf(params, sizeof(params), "slope=%s,length=256", lines[i].slope);
+        measure("draw_line", params, 1, run_line, &lines[i]);
+    }
+}
+
+/*
+ * Triangles
+ */
+
+typedef struct tricase tricase_t;
+
+struct tricase {
+    screentri_t screen;     /* fill_screentriangle and wire_screentriangle input */
+    triangle_t  legacy;     /* draw_triangle input */
+    int         rasterizer;
+};
+
+/* Set up a triangle of the given width and height in the middle of the surface. */
+static void make_triangle(tricase_t *tri, int width, int height, int rasterizer)
+{
+    static const Uint32 palette[1] = { 0x00c08040 };
+    modeltri_t model;
+    transform_t transform;
+
+    memset(&model, 0, sizeof(model));
+    model.x1 = (Sint16)(-width / 2);
+    model.y1 = (Sint16)(height / 2);
+    model.x2 = (Sint16)(width / 2);
+    model.y2 = (Sint16)(height / 2);
+    model.x3 = (Sint16)(width / 4);
+    model.y3 = (Sint16)(-height / 2);
+
+    transform.scale = 1.0f;
+    transform_setrotation(&transform, 0.0f);
+    transform.tx = SURFACE_SIZE / 2;
+    transform.ty = SURFACE_SIZE / 2;
+    transform.palette = palette;
+    transform_triangle(&model, &transform, &tri->screen);
+
+    memset(&tri->legacy, 0, sizeof(tri->legacy));
+    tri->legacy.x1 = model.x1;
+    tri->legacy.y1 = model.y1;
+    tri->legacy.x2 = model.x2;
+    tri->legacy.y2 = model.y2;
+    tri->legacy.x3 = model.x3;
+    tri->legacy.y3 = model.y3;
+    tri->legacy.fillcolor = palette[0];
+    tri->legacy.scale = 1.0f;
+    tri->legacy.tx = SURFACE_SIZE / 2;
+    tri->legacy.ty = SURFACE_SIZE / 2;
+
+    tri->rasterizer = rasterizer;
+}
+
+static void run_screentriangle(void *arg, long iterations)
+{
+    tricase_t *tri = arg;
+    long i;
+
+    for (i = 0; i < iterations; i++) {
+        if (tri->rasterizer == TRIANGLE_WIREFRAME) {
+            wire_screentriangle(surface, &tri->screen, NULL);
+        } else {
+            fill_screentriangle(surface, &tri->screen, NULL);
+        }
+    }
+}
+
+static void run_legacytriangle(void *arg, long iterations)
+{
+    tricase_t *tri = arg;
+    long i;
+
+    for (i = 0; i < iterations; i++) {
+        draw_triangle(surface, &tri->legacy);
+    }
+}
+
+static void bench_triangles(void)
+{
+    static const int sizes[] = { 8, 32, 128, 512 };
+    static const int aspects[] = { 1, 8 };
+    tricase_t tri;
+    char params[64];
+    int i, k;
+
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        for (k = 0; k < (int)(sizeof(aspects) / sizeof(aspects[0])); k++) {
+            int height = sizes[i] / aspects[k] > 1 ? sizes[i] / aspects[k] : 2;
+
+            make_triangle(&tri, sizes[i], height, TRIANGLE_FILLED);
+            snprintf(params, sizeof(params), "fill,size=%d,aspect=%d", sizes[i], aspects[k]);
+            measure("triangle", params, 1, run_screentriangle, &tri);
+        }
+    }
+
+    make_triangle(&tri, 128, 128, TRIANGLE_WIREFRAME);
+    measure("triangle", "wireframe,size=128,aspect=1", 1, run_screentriangle, &tri);
+
+    make_triangle(&tri, 128, 128, TRIANGLE_FILLED);
+    measure("draw_triangle", "legacy,size=128,aspect=1", 1, run_legacytriangle, &tri);
+}
+
+/*
+ * Objects
+ */
+
+typedef struct objectcase objectcase_t;
+
+struct objectcase {
+    object_t        *object;
+    drawcontext_t   context;
+};
+
+static void run_object(void *arg, long iterations)
+{
+    objectcase_t *test = arg;
+    long i;
+
+    for (i = 0; i < iterations; i++) {
+        arena_reset(test->context.frame);
+        draw_object(test->object, &test->context);
+    }
+}
+
+static void bench_objects(void)
+{
+    static const char *paths[] = { "sphere.bbm", "teapot.bbm" };
+    static const float scales[] = { 0.03f, 0.15f, 0.3f, 0.6f };
+    static const float lodpixels[] = { 0.0f, 6.0f };
+    objectcase_t test;
+    model_t *model;
+    char params[64];
+    int i, k, l;
+
+    test.context.frame = arena_create(256 * 1024);
+    test.context.rasterizer = TRIANGLE_FILLED;
+    test.context.stats = NULL;
+    test.context.lodhysteresis = 0.2f;
+    test.context.impostorpixels = 0;
+
+    for (i = 0; i < (int)(sizeof(paths) / sizeof(paths[0])); i++) {
+        model = model_load(paths[i]);
+        if (!model) {
+            fprintf(stderr, "Skipping draw_object cases for %s\n", paths[i]);
+            continue;
+        }
+        test.object = create_object(surface, model);
+        test.object->tx = SURFACE_SIZE / 2;
+        test.object->ty = SURFACE_SIZE / 2;
+
+        for (l = 0; l < (int)(sizeof(lodpixels) / sizeof(lodpixels[0])); l++) {
+            test.context.lodpixels = lodpixels[l];
+            for (k = 0; k < (int)(sizeof(scales) / sizeof(scales[0])); k++) {
+                test.object->scale = scales[k];
+                snprintf(params, sizeof(params), "model=%s,scale=%.2f,lod=%g",
+                         paths[i], scales[k], lodpixels[l]);
+                measure("draw_object", params, 1, run_object, &test);
+            }
+        }
+
+        /* Spheres again as discs, wherever the radius allows */
+        if (model->flags & MODEL_SPHERE) {
+            test.context.lodpixels = 0.0f;
+            test.context.impostorpixels = DISC_MAXRADIUS;
+            for (k = 0; k < (int)(sizeof(scales) / sizeof(scales[0])); k++) {
+                test.object->scale = scales[k];
+                snprintf(params, sizeof(params), "model=%s,scale=%.2f,disc", paths[i], scales[k]);
+                measure("draw_object", params, 1, run_object, &test);
+            }
+            test.context.impostorpixels = 0;
+        }
+
+        destroy_object(test.object);
+        model_destroy(model);
+    }
+
+    destroy_all_objects();
+    arena_destroy(test.context.frame);
+}
+
+/*
+ * Lists
+ */
+
+typedef struct listcase listcase_t;
+
+struct listcase {
+    list_t  *list;
+    int     extra;  /* Item added and removed by the churn cases */
+};
+
+/* Add an item at the front and remove it again, like a short-lived ball. */
+static void run_churn(void *arg, long iterations)
+{
+    listcase_t *test = arg;
+    long i;
+
+    for (i = 0; i < iterations; i++) {
+        list_addfirst(test->list, &test->extra);
+        list_remove(test->list, &test->extra);
+    }
+}
+
+static void run_heaptraversal(void *arg, long iterations)
+{
+    listcase_t *test = arg;
+    list_iterator_t *iter;
+    volatile long sum = 0;
+    int *item;
+    long i;
+
+    for (i = 0; i < iterations; i++) {
+        iter = list_createiterator(test->list);
+        while ((item = list_next(iter)) != NULL) {
+            sum += *item;
+        }
+        list_destroyiterator(iter);
+    }
+}
+
+static void run_stacktraversal(void *arg, long iterations)
+{
+    listcase_t *test = arg;
+    list_iterator_t iter;
+    volatile long sum = 0;
+    int *item;
+    long i;
+
+    for (i = 0; i < iterations; i++) {
+        list_foreach(iter, test->list, item) {
+            sum += *item;
+        }
+    }
+}
+
+static void bench_lists(void)
+{
+    static const int sizes[] = { 16, 1000, 100000 };
+    listcase_t test;
+    listpool_t *pool;
+    int *items;
+    char params[64];
+    int i, k, pooled;
+
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        items = calloc(sizes[i], sizeof(int));
+        if (!items) {
+            return;
+        }
+        for (pooled = 0; pooled <= 1; pooled++) {
+            pool = pooled ? listpool_create(256) : NULL;
+            test.list = list_create(pool);
+            for (k = 0; k < sizes[i]; k++) {
+                items[k] = k;
+                list_addlast(test.list, &items[k]);
+            }
+
+            snprintf(params, sizeof(params), "%s,size=%d", pooled ? "pool" : "malloc", sizes[i]);
+            measure("list_churn", params, 1, run_churn, &test);
+
+            if (!pooled) {
+                snprintf(params, sizeof(params), "heap iterator,size=%d", sizes[i]);
+                measure("list_foreach", params, sizes[i], run_heaptraversal, &test);
+                snprintf(params, sizeof(params), "stack iterator,size=%d", sizes[i]);
+                measure("list_foreach", params, sizes[i], run_stacktraversal, &test);
+            }
+
+            list_destroy(test.list);
+            listpool_destroy(pool);
+        }
+        free(items);
+    }
+}
+
+/*
+ * Physics
+ */
+
+typedef struct physicscase physicscase_t;
+
+struct physicscase {
+    object_t    *balls;
+    int         numballs;
+    physics_t   physics;
+};
+
+static void run_physics(void *arg, long iterations)
+{
+    physicscase_t *test = arg;
+    long i;
+    int k;
+
+    for (i = 0; i < iterations; i++) {
+        for (k = 0; k < test->numballs; k++) {
+            physics_step(&test->balls[k], &test->physics);
+        }
+    }
+}
+
+static void bench_physics(void)
+{
+    static const int counts[] = { 10, 1000, 100000 };
+    physicscase_t test;
+    char params[64];
+    int i, k;
+
+    /*
+     * The app's gravity without drag or bounce losses: balls keep moving
+     * forever instead of slowly settling, so every batch does the same work.
+     */
+    test.physics.gravity = 0.35f;
+    test.physics.air = 1.0f;
+    test.physics.bounce = 1.0f;
+    test.physics.restspeed = 0.0f;
+    test.physics.width = 1600;
+    test.physics.height = 900;
+
+    srand(1);
+    for (i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++) {
+        test.numballs = counts[i];
+        test.balls = calloc(counts[i], sizeof(object_t));
+        if (!test.balls) {
+            return;
+        }
+        for (k = 0; k < counts[i]; k++) {
+            object_t *ball = &test.balls[k];
+
+            ball->scale = 0.15f + ((float)rand() / (float)RAND_MAX) * 0.15f;
+            ball->tx = (float)(rand() % 1400) + 100.0f;
+            ball->ty = (float)(rand() % 300) + 50.0f;
+            ball->speedx = ((float)rand() / (float)RAND_MAX) * 100.0f - 50.0f;
+            ball->speedy = ((float)rand() / (float)RAND_MAX) * 80.0f - 60.0f;
+        }
+
+        snprintf(params, sizeof(params), "balls=%d", counts[i]);
+        measure("physics_step", params, counts[i], run_physics, &test);
+
+        free(test.balls);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *jsonpath = "bench.json";
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonpath = argv[++i];
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            numreps = atoi(argv[++i]);
+            if (numreps < 1 || numreps > BENCH_MAXREPS) {
+                fprintf(stderr, "--reps must be between 1 and %d\n", BENCH_MAXREPS);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--json FILE] [--reps N] [--filter TEXT]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    tickns = 1e9 / (double)SDL_GetPerformanceFrequency();
+    surface = SDL_CreateRGBSurfaceWithFormat(0, SURFACE_SIZE, SURFACE_SIZE, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface) {
+        fprintf(stderr, "Unable to create surface. Error returned: %s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    printf("%-12s %-32s %15s  %11s\n", "benchmark", "parameters", "median", "MAD");
+    bench_lines();
+    bench_triangles();
+    bench_objects();
+    bench_lists();
+    bench_physics();
+
+    SDL_FreeSurface(surface);
+
+    if (!write_json(jsonpath)) {
+        return EXIT_FAILURE;
+    }
+    printf("Wrote %d results to %s\n", numresults, jsonpath);
+
+    return 0;
+}
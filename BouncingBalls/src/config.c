@@ -0,0 +1,351 @@
+/*
+ * Config module: defaults, parsing and validation of run settings.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include "triangle.h"
+#include "disc.h"
+#include "backend.h"
+#include "config.h"
+
+/* Setting value types */
+#define TYPE_INT        0
+#define TYPE_UINT       1
+#define TYPE_FLOAT      2
+#define TYPE_PATH       3
+#define TYPE_ENUM       4
+
+/* Headless runs have no window to close, so they stop after this many frames by default */
+#define HEADLESS_FRAMES 600
+
+/* Frame count before config_parse resolves it, so an explicit 0 is kept */
+#define FRAMES_UNSET    -1
+
+typedef struct setting setting_t;
+
+/* Description of one key: where it is stored and what it accepts */
+struct setting {
+    const char  *key;
+    int         type;
+    size_t      offset;
+    double      min, max;       /* Range of numeric values */
+    const char  **names;        /* Names of enum values, by value */
+    const char  *help;
+};
+
+static const char *rasterizers[] = { "fill", "wireframe", NULL };
+static const char *backends[] = { "window", "headless", NULL };
+
+static const setting_t settings[] = {
+    { "balls",     TYPE_INT,   offsetof(config_t, balls),     1, 1000000, NULL, "number of balls" },
+    { "width",     TYPE_INT,   offsetof(config_t, width),     16, 16384, NULL, "surface width in pixels" },
+    { "height",    TYPE_INT,   offsetof(config_t, height),    16, 16384, NULL, "surface height in pixels" },
+    { "ttl",       TYPE_UINT,  offsetof(config_t, ttl),       0, 3600000, NULL, "ms a settled ball lives" },
+    { "gravity",   TYPE_FLOAT, offsetof(config_t, gravity),   -100, 100, NULL, "speed gained per frame" },
+    { "air",       TYPE_FLOAT, offsetof(config_t, air),       0, 1, NULL, "speed kept per frame" },
+    { "bounce",    TYPE_FLOAT, offsetof(config_t, bounce),    0, 1, NULL, "speed kept per bounce" },
+    { "restspeed", TYPE_FLOAT, offsetof(config_t, restspeed), 0, 100, NULL, "speed below which balls settle" },
+    { "model",     TYPE_PATH,  offsetof(config_t, model),     0, 0, NULL, "ball model (.bbm, .obj or .stl)" },
+    { "seed",      TYPE_UINT,  offsetof(config_t, seed),      0, 4294967295.0, NULL, "random seed, 0 for the clock" },
+    { "frames",    TYPE_INT,   offsetof(config_t, frames),    0, 100000000, NULL, "frames to run, 0 until all balls expire" },
+    { "threads",   TYPE_INT,   offsetof(config_t, threads),   1, 64, NULL, "threads for the physics step" },
+    { "rasterizer", TYPE_ENUM, offsetof(config_t, rasterizer), 0, 0, rasterizers, "fill or wireframe" },
+    { "lodpixels", TYPE_FLOAT, offsetof(config_t, lodpixels), 0, 1000, NULL, "pixels of error allowed in a level of detail, 0 for full detail" },
+    { "lodhysteresis", TYPE_FLOAT, offsetof(config_t, lodhysteresis), 0, 0.9, NULL, "fraction of lodpixels a level must clear to switch" },
+    { "impostor",  TYPE_INT,   offsetof(config_t, impostor),  0, DISC_MAXRADIUS, NULL, "largest radius in pixels to draw spheres as discs, 0 never" },
+    { "backend",   TYPE_ENUM,  offsetof(config_t, backend),   0, 0, backends, "window or headless" },
+    { "output",    TYPE_PATH,  offsetof(config_t, output),    0, 0, NULL, "BMP file to save the last frame to" },
+    { "profile",   TYPE_INT,   offsetof(config_t, profile),   0, 1, NULL, "1 to time frame stages" },
+    { "hud",       TYPE_INT,   offsetof(config_t, hud),       0, 1, NULL, "1 to draw stage timings on screen" },
+    { "stats",     TYPE_PATH,  offsetof(config_t, stats),     0, 0, NULL, "CSV file to log render counters to" },
+    { "trace",     TYPE_PATH,  offsetof(config_t, trace),     0, 0, NULL, "Chrome trace JSON file to write" },
+    { "stress",    TYPE_PATH,  offsetof(config_t, stress),    0, 0, NULL, "CSV file for a headless stress ramp" },
+    { "stressbudget", TYPE_FLOAT, offsetof(config_t, stressbudget), 0, 86400, NULL, "seconds of rendering per stress step" },
+};
+
+#define NUM_SETTINGS    ((int)(sizeof(settings) / sizeof(settings[0])))
+
+/* Fill config with the defaults. */
+void config_default(config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->balls = 10;
+    config->width = 1600;
+    config->height = 900;
+    config->ttl = 5000;
+    config->gravity = 0.35f;
+    config->air = 0.985f;
+    config->bounce = 0.78f;
+    config->restspeed = 0.50f;
+    strcpy(config->model, "sphere.bbm");
+    config->seed = 0;
+    config->frames = FRAMES_UNSET;
+    config->threads = 1;
+    config->rasterizer = TRIANGLE_FILLED;
+    config->lodpixels = 6.0f;
+    config->lodhysteresis = 0.2f;
+    config->impostor = 16;
+    config->backend = BACKEND_WINDOW;
+    config->stressbudget = 30.0f;
+}
+
+/* Return the setting named key, or NULL. */
+static const setting_t *find_setting(const char *key)
+{
+    int i;
+
+    for (i = 0; i < NUM_SETTINGS; i++) {
+        if (strcmp(settings[i].key, key) == 0) {
+            return &settings[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Parse a number that must be entirely numeric and within the setting's range.
+ * The range is checked before the whole-number test, which casts to an integer.
+ */
+static int parse_number(const setting_t *setting, const char *value, double *number)
+{
+    char *end;
+
+    errno = 0;
+    *number = strtod(value, &end);
+    if (end == value || *end != '\0' || errno != 0 || !isfinite(*number)) {
+        fprintf(stderr, "config: %s must be a number, not '%s'\n", setting->key, value);
+        return 0;
+    }
+    if (*number < setting->min || *number > setting->max) {
+        fprintf(stderr, "config: %s must be between %.10g and %.10g, not %s\n",
+                setting->key, setting->min, setting->max, value);
+        return 0;
+    }
+    if (setting->type != TYPE_FLOAT && *number != (double)(long long)*number) {
+        fprintf(stderr, "config: %s must be a whole number, not '%s'\n", setting->key, value);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Set one setting from its text value. */
+int config_set(config_t *config, const char *key, const char *value)
+{
+    const setting_t *setting = find_setting(key);
+    char *field;
+    double number;
+    int i;
+
+    if (!setting) {
+        fprintf(stderr, "config: unknown setting '%s'\n", key);
+        return 0;
+    }
+    field = (char *)config + setting->offset;
+
+    switch (setting->type) {
+    case TYPE_PATH:
+        if (strlen(value) >= CONFIG_MAXPATH) {
+            fprintf(stderr, "config: %s is too long\n", key);
+            return 0;
+        }
+        strcpy(field, value);
+        return 1;
+    case TYPE_ENUM:
+        for (i = 0; setting->names[i]; i++) {
+            if (strcmp(setting->names[i], value) == 0) {
+                *(int *)field = i;
+                return 1;
+            }
+        }
+        fprintf(stderr, "config: %s must be %s, not '%s'\n", key, setting->help, value);
+        return 0;
+    default:
+        if (!parse_number(setting, value, &number)) {
+            return 0;
+        }
+        if (setting->type == TYPE_INT) {
+            *(int *)field = (int)number;
+        } else if (setting->type == TYPE_UINT) {
+            *(unsigned int *)field = (unsigned int)number;
+        } else {
+            *(float *)field = (float)number;
+        }
+        return 1;
+    }
+}
+
+/* Strip leading and trailing whitespace in place. */
+static char *trim(char *text)
+{
+    char *end;
+
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    end = text + strlen(text);
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t' ||
+                          end[-1] == '\n' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+
+    return text;
+}
+
+/* Read settings from a file of key=value lines. */
+int config_load(config_t *config, const char *path)
+{
+    char line[CONFIG_MAXPATH + 64];
+    char *key, *value, *equals;
+    FILE *file;
+    int lineno = 0;
+    int ok = 1;
+
+    file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "config: unable to open %s\n", path);
+        return 0;
+    }
+
+    while (ok && fgets(line, sizeof(line), file)) {
+        lineno++;
+        key = trim(line);
+        if (*key == '\0' || *key == '#') {
+            continue;
+        }
+        equals = strchr(key, '=');
+        if (!equals) {
+            fprintf(stderr, "config: %s:%d: expected key=value\n", path, lineno);
+            ok = 0;
+            break;
+        }
+        *equals = '\0';
+        key = trim(key);
+        value = trim(equals + 1);
+        if (!config_set(config, key, value)) {
+            fprintf(stderr, "config: in %s:%d\n", path, lineno);
+            ok = 0;
+        }
+    }
+
+    fclose(file);
+
+    return ok;
+}
+
+/* Print command line usage and the settings it accepts. */
+static void usage(const char *program)
+{
+    int i;
+
+    fprintf(stderr, "Usage: %s [--config FILE] [--headless] [--KEY VALUE | --KEY=VALUE]...\n", program);
+    fprintf(stderr, "Settings:\n");
+    for (i = 0; i < NUM_SETTINGS; i++) {
+        fprintf(stderr, "  --%-13s %s\n", settings[i].key, settings[i].help);
+    }
+}
+
+/* Apply command line arguments on top of config. */
+int config_parse(config_t *config, int argc, char **argv)
+{
+    char key[64];
+    const char *arg, *value, *equals;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            fprintf(stderr, "config: unexpected argument '%s'\n", arg);
+            usage(argv[0]);
+            return 0;
+        }
+        arg += 2;
+
+        /* Shorthands */
+        if (strcmp(arg, "help") == 0) {
+            usage(argv[0]);
+            return 0;
+        }
+        if (strcmp(arg, "headless") == 0) {
+            config->backend = BACKEND_HEADLESS;
+            continue;
+        }
+
+        equals = strchr(arg, '=');
+        if (equals) {
+            if ((size_t)(equals - arg) >= sizeof(key)) {
+                fprintf(stderr, "config: unknown setting '%s'\n", arg);
+                return 0;
+            }
+            memcpy(key, arg, equals - arg);
+            key[equals - arg] = '\0';
+            value = equals + 1;
+        } else {
+            if (strlen(arg) >= sizeof(key) || i + 1 >= argc) {
+                fprintf(stderr, "config: --%s needs a value\n", arg);
+                usage(argv[0]);
+                return 0;
+            }
+            strcpy(key, arg);
+            value = argv[++i];
+        }
+
+        if (strcmp(key, "config") == 0) {
+            if (!config_load(config, value)) {
+                return 0;
+            }
+        } else if (!config_set(config, key, value)) {
+            return 0;
+        }
+    }
+
+    /* Record the seed actually used so the run can be repeated */
+    if (config->seed == 0) {
+        config->seed = (unsigned int)time(NULL);
+    }
+    if (config->frames == FRAMES_UNSET) {
+        config->frames = config->backend == BACKEND_HEADLESS ? HEADLESS_FRAMES : 0;
+    }
+    if (config->hud) {
+        config->profile = 1;
+    }
+
+    return 1;
+}
+
+/* Print the effective configuration. */
+void config_print(const config_t *config, FILE *file)
+{
+    const char *field;
+    int i;
+
+    for (i = 0; i < NUM_SETTINGS; i++) {
+        const setting_t *setting = &settings[i];
+
+        field = (const char *)config + setting->offset;
+        fprintf(file, "%s=", setting->key);
+        switch (setting->type) {
+        case TYPE_INT:
+            fprintf(file, "%d\n", *(const int *)field);
+            break;
+        case TYPE_UINT:
+            fprintf(file, "%u\n", *(const unsigned int *)field);
+            break;
+        case TYPE_FLOAT:
+            fprintf(file, "%g\n", *(const float *)field);
+            break;
+        case TYPE_PATH:
+            fprintf(file, "%s\n", field);
+            break;
+        case TYPE_ENUM:
+            fprintf(file, "%s\n", setting->names[*(const int *)field]);
+            break;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stdio.h>
+
+/*
+ * Scenario configuration interface
+ *
+ * Every tunable of a run, with defaults matching the original animation.
+ * Settings come from an optional key=value file (--config FILE), then from
+ * the command line as --key value or --key=value, later ones winning. Each
+ * value is validated as it is set, and the effective configuration is
+ * printed at startup so perf logs describe the run that produced them.
+ */
+
+#define CONFIG_MAXPATH      256
+
+typedef struct config config_t;
+
+struct config {
+    int             balls;          /* Number of balls spawned */
+    int             width;          /* Surface size in pixels */
+    int             height;
+    unsigned int    ttl;            /* Lifetime of a settled ball in ms */
+    float           gravity;        /* Physics constants, see physics.h */
+    float           air;
+    float           bounce;
+    float           restspeed;
+    char            model[CONFIG_MAXPATH];  /* Ball model file */
+    unsigned int    seed;           /* Random seed; 0 picks one from the clock */
+    int             frames;         /* Frames to run, 0 until every ball has expired; -1 until resolved */
+    int             threads;        /* Threads for the physics step, counting the main thread */
+    int             rasterizer;     /* TRIANGLE_FILLED or TRIANGLE_WIREFRAME */
+    float           lodpixels;      /* Level of detail thresholds, see drawcontext_t */
+    float           lodhysteresis;
+    int             impostor;       /* Largest disc radius for sphere impostors, see drawcontext_t */
+    int             backend;        /* BACKEND_WINDOW or BACKEND_HEADLESS */
+    char            output[CONFIG_MAXPATH]; /* BMP file for the last frame, or empty */
+    int             profile;        /* Time frame stages and print a summary on exit */
+    int             hud;            /* Draw the stage timings over the frame; implies profile */
+    char            stats[CONFIG_MAXPATH];  /* CSV file for per-frame render counters, or empty */
+    char            trace[CONFIG_MAXPATH];  /* Chrome trace-event JSON file, or empty */
+    char            stress[CONFIG_MAXPATH]; /* CSV file for the stress ramp; runs it instead if set */
+    float           stressbudget;   /* Seconds of rendering allowed per stress step */
+};
+
+/*
+ * Fill config with the defaults.
+ */
+void config_default(config_t *config);
+
+/*
+ * Set one setting from its text value. Returns 1 on success, 0 if the key
+ * is unknown or the value is invalid.
+ */
+int config_set(config_t *config, const char *key, const char *value);
+
+/*
+ * Read settings from a file of key=value lines. Blank lines and lines
+ * starting with # are ignored. Returns 1 on success, 0 on error.
+ */
+int config_load(config_t *config, const char *path);
+
+/*
+ * Apply command line arguments on top of config, then resolve the seed
+ * and the frame count if none was given: 600 headless, otherwise 0.
+ * Returns 1 on success, 0 on error (after printing usage).
+ */
+int config_parse(config_t *config, int argc, char **argv);
+
+/*
+ * Print the effective configuration, one key=value per line, in the
+ * format config_load reads.
+ */
+void config_print(const config_t *config, FILE *file);
+
+#endif /*CONFIG_H_*/
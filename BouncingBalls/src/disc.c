@@ -0,0 +1,194 @@
+/*
+ * Disc module: filled, banded circles drawn as spans.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "disc.h"
+#include "profile.h"
+
+/*
+ * Store in extent[dy] the half-width of a filled circle of the given
+ * radius at dy rows from its centre, for 0 <= dy <= radius.
+ */
+static void circle_extents(int radius, int *extent)
+{
+    int x = radius, y = 0;
+    int d = 1 - radius;
+
+    for (y = 0; y <= radius; y++) {
+        extent[y] = 0;
+    }
+
+    /* Walk one octant; each step gives a row of it and a row of its mirror */
+    y = 0;
+    while (x >= y) {
+        extent[y] = x > extent[y] ? x : extent[y];
+        extent[x] = y > extent[x] ? y : extent[x];
+        y++;
+        if (d < 0) {
+            d += 2 * y + 1;
+        } else {
+            x--;
+            d += 2 * (y - x) + 1;
+        }
+    }
+}
+
+/* Write the span from x1 to x2 on row y, clipped to the surface. */
+static void fill_span(SDL_Surface *surface, int x1, int x2, int y, Uint32 color,
+                      renderstats_t *stats)
+{
+    Uint32 *row;
+    int x;
+
+    if (x1 < 0) {
+        x1 = 0;
+    }
+    if (x2 >= surface->w) {
+        x2 = surface->w - 1;
+    }
+    if (x1 > x2) {
+        return;
+    }
+
+    row = (Uint32 *)surface->pixels + y * surface->w;
+    for (x = x1; x <= x2; x++) {
+        row[x] = color;
+    }
+    if (stats) {
+        renderstats_span(stats, x1, x2, y);
+    }
+}
+
+/*
+ * Fill in the outer radius and row extents of each ring of a disc, and
+ * return the number of rings left once those that round away to nothing
+ * are dropped.
+ */
+static int ring_extents(int radius, int numbands, int *radii,
+                        int extents[][DISC_MAXRADIUS + 1])
+{
+    int k;
+
+    for (k = 0; k < numbands; k++) {
+        radii[k] = radius * (numbands - k) / numbands;
+        if (k > 0 && radii[k] == radii[k - 1]) {
+            break;
+        }
+        circle_extents(radii[k], extents[k]);
+    }
+
+    return k;
+}
+
+/* Return 0 if the arguments are out of range, 1 if they are fine. */
+static int valid_disc(int radius, int numbands)
+{
+    return radius >= 0 && radius <= DISC_MAXRADIUS && numbands >= 1 && numbands <= DISC_MAXBANDS;
+}
+
+/* Return 1 if the disc lies wholly off the surface. */
+static int off_surface(SDL_Surface *surface, int cx, int cy, int radius)
+{
+    return cx + radius < 0 || cx - radius >= surface->w ||
+           cy + radius < 0 || cy - radius >= surface->h;
+}
+
+/* Draw a disc of rings on the surface. */
+int draw_disc(SDL_Surface *surface, int cx, int cy, int radius,
+              const Uint32 *colors, int numbands, renderstats_t *stats)
+{
+    int extents[DISC_MAXBANDS][DISC_MAXRADIUS + 1];
+    int radii[DISC_MAXBANDS];
+    int k, dy, y;
+
+    if (!valid_disc(radius, numbands)) {
+        return 0;
+    }
+    if (off_surface(surface, cx, cy, radius)) {
+        return 1;
+    }
+
+    PROFILE_BEGIN(fill);
+
+    /* Ring k reaches out to radii[k] */
+    numbands = ring_extents(radius, numbands, radii, extents);
+
+    for (dy = -radius; dy <= radius; dy++) {
+        int row = abs(dy);
+
+        y = cy + dy;
+        if (y < 0 || y >= surface->h) {
+            continue;
+        }
+
+        /* Each ring covers its own extent minus the next ring's, on both sides */
+        for (k = 0; k < numbands && row <= radii[k]; k++) {
+            int outer = extents[k][row];
+            int inner = k + 1 < numbands && row <= radii[k + 1] ? extents[k + 1][row] : -1;
+
+            if (inner < 0) {
+                fill_span(surface, cx - outer, cx + outer, y, colors[k], stats);
+                break;
+            }
+            fill_span(surface, cx - outer, cx - inner - 1, y, colors[k], stats);
+            fill_span(surface, cx + inner + 1, cx + outer, y, colors[k], stats);
+        }
+    }
+
+    PROFILE_END(PROFILE_FILL, fill);
+
+    return 1;
+}
+
+/* Draw the outer edge of each ring of a disc on the surface. */
+int draw_discoutline(SDL_Surface *surface, int cx, int cy, int radius,
+                     const Uint32 *colors, int numbands, renderstats_t *stats)
+{
+    int extents[DISC_MAXBANDS][DISC_MAXRADIUS + 1];
+    int radii[DISC_MAXBANDS];
+    int k, dy, y;
+
+    if (!valid_disc(radius, numbands)) {
+        return 0;
+    }
+    if (off_surface(surface, cx, cy, radius)) {
+        return 1;
+    }
+
+    PROFILE_BEGIN(lines);
+
+    numbands = ring_extents(radius, numbands, radii, extents);
+
+    for (dy = -radius; dy <= radius; dy++) {
+        int row = abs(dy);
+
+        y = cy + dy;
+        if (y < 0 || y >= surface->h) {
+            continue;
+        }
+
+        /*
+         * On each row a ring's edge runs from its extent in to just past
+         * its extent on the next row out, so steep parts of the edge stay
+         * connected; the ring's top and bottom rows are all edge.
+         */
+        for (k = 0; k < numbands && row <= radii[k]; k++) {
+            int outer = extents[k][row];
+            int inner = row < radii[k] ? extents[k][row + 1] : -1;
+
+            inner = inner < outer ? inner : outer - 1;
+            if (inner < 0) {
+                fill_span(surface, cx - outer, cx + outer, y, colors[k], stats);
+                continue;
+            }
+            fill_span(surface, cx - outer, cx - inner - 1, y, colors[k], stats);
+            fill_span(surface, cx + inner + 1, cx + outer, y, colors[k], stats);
+        }
+    }
+
+    PROFILE_END(PROFILE_LINES, lines);
+
+    return 1;
+}
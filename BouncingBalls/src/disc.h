@@ -0,0 +1,41 @@
+#ifndef DISC_H_
+#define DISC_H_
+
+#include <SDL2/SDL.h>
+#include "renderstats.h"
+
+/*
+ * Disc primitive interface
+ *
+ * Draws a filled disc as horizontal spans, the fast path for round
+ * models. The half-width of every row is found once with the midpoint
+ * circle algorithm, so a disc costs one span per row and ring instead of
+ * an outline and fill per triangle. The disc may be split into numbands
+ * concentric rings of equal width, colors[0] being the outermost; each
+ * pixel is written exactly once.
+ */
+
+/* Largest radius in pixels draw_disc accepts */
+#define DISC_MAXRADIUS      256
+
+/* Largest number of rings */
+#define DISC_MAXBANDS       8
+
+/*
+ * Draw a disc of the given radius centred on (cx, cy) on the surface,
+ * clipped to the surface, in numbands rings colored from the outside in.
+ * Counts the spans in stats unless it is NULL. Radius 0 is a single
+ * pixel. Returns 1 if drawn, 0 if the radius or band count is out of range.
+ */
+int draw_disc(SDL_Surface *surface, int cx, int cy, int radius,
+              const Uint32 *colors, int numbands, renderstats_t *stats);
+
+/*
+ * Draw only the outer edge of each ring of the disc draw_disc would draw,
+ * one pixel wide, in the ring's color. Used by the wireframe rasterizer.
+ * Returns 1 if drawn, 0 if the radius or band count is out of range.
+ */
+int draw_discoutline(SDL_Surface *surface, int cx, int cy, int radius,
+                     const Uint32 *colors, int numbands, renderstats_t *stats);
+
+#endif /*DISC_H_*/
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <SDL2/SDL.h>
+#include "drawline.h"
 
 /* 
  * Read color of pixel (x, y) from the surface
@@ -39,10 +40,30 @@ void set_pixel(SDL_Surface *surface, int x, int y, Uint32 color)
     pixels[idx] = color;
 }
 
+/*
+ * Set pixel (x, y) and count it in stats, if any
+ */
+static void plot(SDL_Surface *surface, int x, int y, Uint32 color, renderstats_t *stats)
+{
+    set_pixel(surface, x, y, color);
+    if (stats) {
+        renderstats_pixel(stats, x, y);
+    }
+}
+
 /*
  * Draw a line on the surface from point (x1, y1) to point (x2, y2) using color
  */
 void draw_line(SDL_Surface *surface, int x1, int y1, int x2, int y2, Uint32 color)
+{
+    draw_countedline(surface, x1, y1, x2, y2, color, NULL);
+}
+
+/*
+ * Draw a line like draw_line, counting its pixels in stats unless it is NULL
+ */
+void draw_countedline(SDL_Surface *surface, int x1, int y1, int x2, int y2, Uint32 color,
+                      renderstats_t *stats)
 {
     int fraction;
     int x, dx, stepx;
@@ -72,7 +93,7 @@ void draw_line(SDL_Surface *surface, int x1, int y1, int x2, int y2, Uint32 colo
     dx = dx*2;
     x = x1;
     y = y1;
-    set_pixel(surface, x, y, color);
+    plot(surface, x, y, color, stats);
     if (dx > dy) {
         fraction = dy - (dx/2);
         while (x != x2) {
@@ -82,7 +103,7 @@ void draw_line(SDL_Surface *surface, int x1, int y1, int x2, int y2, Uint32 colo
             }
             x = x + stepx;
             fraction = fraction + dy;
-            set_pixel(surface, x, y, color);
+            plot(surface, x, y, color, stats);
         }	
     } else {
         fraction = dx - (dy/2);
@@ -93,7 +114,7 @@ void draw_line(SDL_Surface *surface, int x1, int y1, int x2, int y2, Uint32 colo
             }
             y = y + stepy;
             fraction = fraction + dx;
-            set_pixel(surface, x, y, color);
+            plot(surface, x, y, color, stats);
         }	
     }
 }
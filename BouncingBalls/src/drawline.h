@@ -2,12 +2,20 @@
 #define DRAWLINE_H_
 
 #include <SDL2/SDL.h>
+#include "renderstats.h"
 
 /*
  * Draw a line on the surface from point (x1, y1) to point (x2, y2) using color
  */
 void draw_line(SDL_Surface *surface, int x1, int y1, int x2, int y2, Uint32 color);
 
+/*
+ * Draw a line like draw_line, and count every pixel it sets in stats
+ * unless stats is NULL
+ */
+void draw_countedline(SDL_Surface *surface, int x1, int y1, int x2, int y2, Uint32 color,
+                      renderstats_t *stats);
+
 /* 
  * Read color of pixel (x, y) from the surface
  */
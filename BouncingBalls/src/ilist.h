@@ -0,0 +1,113 @@
+#ifndef ILIST_H_
+#define ILIST_H_
+
+#include <stddef.h>
+
+/*
+ * Intrusive list interface
+ *
+ * Unlike list_t, an intrusive list stores no nodes of its own: every item
+ * embeds an ilink_t, and the list threads through those links. Adding and
+ * removing items never allocates, and an item can unlink itself in O(1)
+ * while the list is being iterated with ilist_foreach_safe.
+ */
+
+typedef struct ilink ilink_t;
+
+struct ilink {
+    ilink_t *next;
+    ilink_t *prev;
+};
+
+typedef struct ilist ilist_t;
+
+struct ilist {
+    ilink_t head;       /* Sentinel; head.next is the first item */
+    int numitems;
+};
+
+/*
+ * Return the item of the given type that embeds link as its member field.
+ */
+#define ilist_entry(link, type, member) \
+    ((type *)((char *)(link) - offsetof(type, member)))
+
+/*
+ * Iterate link over all links in the list. The current item must not be removed.
+ */
+#define ilist_foreach(list, link) \
+    for ((link) = (list)->head.next; (link) != &(list)->head; (link) = (link)->next)
+
+/*
+ * Iterate link over all links in the list, allowing the current item to be removed.
+ */
+#define ilist_foreach_safe(list, link, tmp) \
+    for ((link) = (list)->head.next, (tmp) = (link)->next; \
+         (link) != &(list)->head; \
+         (link) = (tmp), (tmp) = (link)->next)
+
+/*
+ * Make the list empty. Must be called before the list is used.
+ */
+static inline void ilist_init(ilist_t *list)
+{
+    list->head.next = &list->head;
+    list->head.prev = &list->head;
+    list->numitems = 0;
+}
+
+/* Insert link between prev and next. */
+static inline void ilist_insert(ilist_t *list, ilink_t *link, ilink_t *prev, ilink_t *next)
+{
+    link->prev = prev;
+    link->next = next;
+    prev->next = link;
+    next->prev = link;
+    list->numitems++;
+}
+
+/*
+ * Adds an item first in the provided list.
+ */
+static inline void ilist_addfirst(ilist_t *list, ilink_t *link)
+{
+    ilist_insert(list, link, &list->head, list->head.next);
+}
+
+/*
+ * Adds an item last in the provided list.
+ */
+static inline void ilist_addlast(ilist_t *list, ilink_t *link)
+{
+    ilist_insert(list, link, list->head.prev, &list->head);
+}
+
+/*
+ * Unlinks an item from the list it is in.
+ */
+static inline void ilist_remove(ilist_t *list, ilink_t *link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = NULL;
+    link->prev = NULL;
+    list->numitems--;
+}
+
+/*
+ * Return the number of items in the list.
+ */
+static inline int ilist_size(ilist_t *list)
+{
+    return list->numitems;
+}
+
+/*
+ * Return 1 if the item is currently linked into a list, 0 otherwise.
+ */
+static inline int ilist_linked(ilink_t *link)
+{
+    return link->next != NULL;
+}
+
+#endif /*ILIST_H_*/
@@ -0,0 +1,457 @@
+/*
+ * Streaming OBJ/STL importer projecting 3D meshes into 2D models.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "triangle.h"
+#include "model.h"
+#include "import.h"
+
+/* Longest OBJ line the importer accepts */
+#define IMPORT_MAXLINE      4096
+
+/* Number of shades in the palette ramp imported meshes are colored with */
+#define IMPORT_NUMSHADES    64
+
+/* Size of a binary STL header and of one triangle record */
+#define STL_HEADERSIZE      80
+#define STL_RECORDSIZE      50
+
+/* Triangle projected onto the xy plane, awaiting fitting and sorting */
+typedef struct importtri importtri_t;
+
+struct importtri {
+    float x1, y1, x2, y2, x3, y3;
+    float depth;        /* Mean z of the corners; larger is nearer */
+    float shade;        /* 0 when seen edge-on, 1 when facing the viewer */
+};
+
+/* State shared by the importers while a file is streamed in */
+typedef struct importer importer_t;
+
+struct importer {
+    const char *path;
+    int lineno;
+
+    float *vertices;    /* OBJ vertex positions, three floats each */
+    int numvertices;
+    int maxvertices;
+
+    importtri_t *triangles;
+    int numtriangles;
+    int maxtriangles;
+};
+
+/* Grow an array of elemsize-byte elements so it can hold one more. */
+static int grow(void **array, int *max, int count, size_t elemsize)
+{
+    void *grown;
+    int newmax;
+
+    if (count < *max) {
+        return 1;
+    }
+
+    newmax = *max ? *max * 2 : 1024;
+    grown = realloc(*array, elemsize * newmax);
+    if (!grown) {
+        return 0;
+    }
+
+    *array = grown;
+    *max = newmax;
+
+    return 1;
+}
+
+/* Project one 3D triangle and queue it. Degenerate triangles are dropped. */
+static int add_triangle(importer_t *imp, const float *a, const float *b, const float *c)
+{
+    importtri_t *tri;
+    float ux, uy, uz, vx, vy, vz;
+    float nx, ny, nz, len;
+
+    ux = b[0] - a[0]; uy = b[1] - a[1]; uz = b[2] - a[2];
+    vx = c[0] - a[0]; vy = c[1] - a[1]; vz = c[2] - a[2];
+    nx = uy * vz - uz * vy;
+    ny = uz * vx - ux * vz;
+    nz = ux * vy - uy * vx;
+    len = sqrtf(nx * nx + ny * ny + nz * nz);
+    if (len == 0.0f) {
+        return 1;
+    }
+
+    if (!grow((void **)&imp->triangles, &imp->maxtriangles, imp->numtriangles, sizeof(importtri_t))) {
+        fprintf(stderr, "%s: out of memory\n", imp->path);
+        return 0;
+    }
+
+    tri = &imp->triangles[imp->numtriangles++];
+    tri->x1 = a[0]; tri->y1 = a[1];
+    tri->x2 = b[0]; tri->y2 = b[1];
+    tri->x3 = c[0]; tri->y3 = c[1];
+    tri->depth = (a[2] + b[2] + c[2]) / 3.0f;
+    tri->shade = fabsf(nz) / len;
+
+    return 1;
+}
+
+/* qsort comparator putting far triangles (small z) first. */
+static int compare_depth(const void *a, const void *b)
+{
+    float da = ((const importtri_t *)a)->depth;
+    float db = ((const importtri_t *)b)->depth;
+
+    return (da > db) - (da < db);
+}
+
+/* Return the ramp color for a shade in [0, 1]. */
+static unsigned int shade_color(float shade)
+{
+    int level = (int)(shade * (IMPORT_NUMSHADES - 1) + 0.5f);
+    int r = 40 + level * 215 / (IMPORT_NUMSHADES - 1);
+    int g = 30 + level * 160 / (IMPORT_NUMSHADES - 1);
+    int b = 20 + level * 90 / (IMPORT_NUMSHADES - 1);
+
+    return (unsigned int)(r << 16 | g << 8 | b);
+}
+
+/* Round a projected coordinate into model space. */
+static int to_model(float v, float center, float scale)
+{
+    return (int)lrintf((v - center) * scale);
+}
+
+/* Sort, fit and quantize the queued triangles into a model. */
+static model_t *finish_import(importer_t *imp)
+{
+    triangle_t *triangles;
+    model_t *model;
+    float minx, maxx, miny, maxy, cx, cy, extent, scale;
+    int i, n = 0;
+
+    if (imp->numtriangles == 0) {
+        fprintf(stderr, "%s: no triangles found\n", imp->path);
+        return NULL;
+    }
+
+    minx = maxx = imp->triangles[0].x1;
+    miny = maxy = imp->triangles[0].y1;
+    for (i = 0; i < imp->numtriangles; i++) {
+        importtri_t *t = &imp->triangles[i];
+        minx = fminf(minx, fminf(t->x1, fminf(t->x2, t->x3)));
+        maxx = fmaxf(maxx, fmaxf(t->x1, fmaxf(t->x2, t->x3)));
+        miny = fminf(miny, fminf(t->y1, fminf(t->y2, t->y3)));
+        maxy = fmaxf(maxy, fmaxf(t->y1, fmaxf(t->y2, t->y3)));
+    }
+    cx = (minx + maxx) / 2.0f;
+    cy = (miny + maxy) / 2.0f;
+    extent = fmaxf(maxx - minx, maxy - miny) / 2.0f;
+    scale = extent > 0.0f ? IMPORT_MODELRADIUS / extent : 1.0f;
+
+    qsort(imp->triangles, imp->numtriangles, sizeof(importtri_t), compare_depth);
+
+    triangles = malloc(sizeof(triangle_t) * imp->numtriangles);
+    if (!triangles) {
+        fprintf(stderr, "%s: out of memory\n", imp->path);
+        return NULL;
+    }
+
+    for (i = 0; i < imp->numtriangles; i++) {
+        importtri_t *t = &imp->triangles[i];
+        triangle_t *dst = &triangles[n];
+
+        /* Screen y grows downwards, model y upwards. */
+        memset(dst, 0, sizeof(*dst));
+        dst->x1 = to_model(t->x1, cx, scale);
+        dst->y1 = -to_model(t->y1, cy, scale);
+        dst->x2 = to_model(t->x2, cx, scale);
+        dst->y2 = -to_model(t->y2, cy, scale);
+        dst->x3 = to_model(t->x3, cx, scale);
+        dst->y3 = -to_model(t->y3, cy, scale);
+        dst->fillcolor = shade_color(t->shade);
+        dst->scale = 1.0f;
+
+        /* Drop triangles that collapsed to a point after quantization. */
+        if (dst->x1 == dst->x2 && dst->x2 == dst->x3 &&
+            dst->y1 == dst->y2 && dst->y2 == dst->y3) {
+            continue;
+        }
+        n++;
+    }
+
+    if (n == 0) {
+        fprintf(stderr, "%s: no triangles left after fitting\n", imp->path);
+        free(triangles);
+        return NULL;
+    }
+    model = model_create(triangles, n);
+    free(triangles);
+
+    return model;
+}
+
+/* Free the importer's buffers. */
+static void free_importer(importer_t *imp)
+{
+    free(imp->vertices);
+    free(imp->triangles);
+}
+
+/* Parse one OBJ face corner ("v", "v/vt", "v//vn" or "v/vt/vn") into a vertex index. */
+static int parse_corner(importer_t *imp, char *token, int *index)
+{
+    char *end;
+    long v = strtol(token, &end, 10);
+
+    if (end == token || (*end != '\0' && *end != '/')) {
+        fprintf(stderr, "%s:%d: bad face corner '%s'\n", imp->path, imp->lineno, token);
+        return 0;
+    }
+
+    /* Negative indices count back from the latest vertex. */
+    if (v < 0) {
+        v = imp->numvertices + v;
+    } else {
+        v = v - 1;
+    }
+    if (v < 0 || v >= imp->numvertices) {
+        fprintf(stderr, "%s:%d: face refers to undefined vertex\n", imp->path, imp->lineno);
+        return 0;
+    }
+
+    *index = (int)v;
+
+    return 1;
+}
+
+/* Handle one line of an OBJ file; only vertices and faces matter. */
+static int parse_obj_line(importer_t *imp, char *line)
+{
+    char *token, *save;
+    int first, prev, cur, corners;
+
+    imp->lineno++;
+
+    if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+        float *v;
+
+        if (!grow((void **)&imp->vertices, &imp->maxvertices, imp->numvertices, sizeof(float) * 3)) {
+            fprintf(stderr, "%s: out of memory\n", imp->path);
+            return 0;
+        }
+        v = &imp->vertices[imp->numvertices * 3];
+        if (sscanf(line + 2, "%f %f %f", &v[0], &v[1], &v[2]) != 3) {
+            fprintf(stderr, "%s:%d: bad vertex\n", imp->path, imp->lineno);
+            return 0;
+        }
+        /* A NaN would break the depth sort and the fit to model space */
+        if (!isfinite(v[0]) || !isfinite(v[1]) || !isfinite(v[2])) {
+            fprintf(stderr, "%s:%d: vertex is not finite\n", imp->path, imp->lineno);
+            return 0;
+        }
+        imp->numvertices++;
+        return 1;
+    }
+
+    if (line[0] != 'f' || (line[1] != ' ' && line[1] != '\t')) {
+        return 1;
+    }
+
+    /* Triangulate the polygon as a fan around its first corner. */
+    first = prev = -1;
+    corners = 0;
+    for (token = strtok_r(line + 2, " \t\r", &save); token; token = strtok_r(NULL, " \t\r", &save)) {
+        if (!parse_corner(imp, token, &cur)) {
+            return 0;
+        }
+        if (corners == 0) {
+            first = cur;
+        } else if (corners >= 2 &&
+                   !add_triangle(imp, &imp->vertices[first * 3],
+                                 &imp->vertices[prev * 3], &imp->vertices[cur * 3])) {
+            return 0;
+        }
+        prev = cur;
+        corners++;
+    }
+
+    if (corners < 3) {
+        fprintf(stderr, "%s:%d: face has fewer than three corners\n", imp->path, imp->lineno);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Import a Wavefront OBJ file, reading it a chunk at a time. */
+model_t *import_obj(const char *path)
+{
+    importer_t imp;
+    model_t *model = NULL;
+    char *chunk, *line;
+    size_t n, i;
+    int linelen = 0, ok = 1;
+    FILE *file;
+
+    memset(&imp, 0, sizeof(imp));
+    imp.path = path;
+
+    file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return NULL;
+    }
+
+    chunk = malloc(IMPORT_CHUNKSIZE);
+    line = malloc(IMPORT_MAXLINE);
+    if (!chunk || !line) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        ok = 0;
+    }
+
+    /* Lines may straddle chunks, so they are assembled byte by byte. */
+    while (ok && (n = fread(chunk, 1, IMPORT_CHUNKSIZE, file)) > 0) {
+        for (i = 0; ok && i < n; i++) {
+            if (chunk[i] == '\n') {
+                line[linelen] = '\0';
+                ok = parse_obj_line(&imp, line);
+                linelen = 0;
+            } else if (linelen < IMPORT_MAXLINE - 1) {
+                line[linelen++] = chunk[i];
+            } else {
+                fprintf(stderr, "%s:%d: line too long\n", path, imp.lineno + 1);
+                ok = 0;
+            }
+        }
+    }
+    if (ok && ferror(file)) {
+        fprintf(stderr, "Error reading %s\n", path);
+        ok = 0;
+    }
+    if (ok && linelen > 0) {
+        line[linelen] = '\0';
+        ok = parse_obj_line(&imp, line);
+    }
+
+    if (ok) {
+        model = finish_import(&imp);
+    }
+
+    fclose(file);
+    free(chunk);
+    free(line);
+    free_importer(&imp);
+
+    return model;
+}
+
+/* Read a little-endian float from an STL record. */
+static float read_float(const unsigned char *p)
+{
+    Uint32 bits = (Uint32)p[0] | (Uint32)p[1] << 8 | (Uint32)p[2] << 16 | (Uint32)p[3] << 24;
+    float f;
+
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/* Import a binary STL file, reading whole records a chunk at a time. */
+model_t *import_stl(const char *path)
+{
+    const size_t perchunk = IMPORT_CHUNKSIZE / STL_RECORDSIZE;
+    unsigned char header[STL_HEADERSIZE + 4];
+    importer_t imp;
+    model_t *model = NULL;
+    unsigned char *chunk;
+    Uint32 count, done = 0;
+    size_t n, i;
+    int ok = 1;
+    FILE *file;
+
+    memset(&imp, 0, sizeof(imp));
+    imp.path = path;
+
+    file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return NULL;
+    }
+
+    if (fread(header, sizeof(header), 1, file) != 1) {
+        fprintf(stderr, "%s: truncated STL header\n", path);
+        fclose(file);
+        return NULL;
+    }
+    count = (Uint32)header[80] | (Uint32)header[81] << 8 |
+            (Uint32)header[82] << 16 | (Uint32)header[83] << 24;
+
+    chunk = malloc(perchunk * STL_RECORDSIZE);
+    if (!chunk) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        ok = 0;
+    }
+
+    while (ok && done < count) {
+        size_t want = count - done < perchunk ? count - done : perchunk;
+
+        n = fread(chunk, STL_RECORDSIZE, want, file);
+        if (n == 0) {
+            /* ASCII STL files also start with "solid", but never match the record count. */
+            fprintf(stderr, "%s: truncated after %u of %u triangles (ASCII STL is not supported)\n",
+                    path, done, count);
+            ok = 0;
+            break;
+        }
+
+        for (i = 0; ok && i < n; i++) {
+            const unsigned char *rec = chunk + i * STL_RECORDSIZE;
+            float v[9];
+            int k;
+
+            /* Skip the stored normal; it is recomputed from the corners. */
+            for (k = 0; k < 9; k++) {
+                v[k] = read_float(rec + 12 + k * 4);
+                if (!isfinite(v[k])) {
+                    fprintf(stderr, "%s: triangle %u has a corner that is not finite\n",
+                            path, done + (Uint32)i + 1);
+                    ok = 0;
+                    break;
+                }
+            }
+            if (ok) {
+                ok = add_triangle(&imp, &v[0], &v[3], &v[6]);
+            }
+        }
+        done += (Uint32)n;
+    }
+
+    if (ok) {
+        model = finish_import(&imp);
+    }
+
+    fclose(file);
+    free(chunk);
+    free_importer(&imp);
+
+    return model;
+}
+
+/* Import a mesh file, choosing the format from its extension. */
+model_t *import_model(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+
+    if (ext && strcasecmp(ext, ".obj") == 0) {
+        return import_obj(path);
+    }
+    if (ext && strcasecmp(ext, ".stl") == 0) {
+        return import_stl(path);
+    }
+
+    fprintf(stderr, "%s: unknown mesh format; expected .obj or .stl\n", path);
+    return NULL;
+}
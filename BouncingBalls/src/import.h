@@ -0,0 +1,39 @@
+#ifndef IMPORT_H_
+#define IMPORT_H_
+
+#include "model.h"
+
+/*
+ * Mesh importer interface
+ *
+ * Reads Wavefront OBJ and binary STL files in fixed-size chunks, so the
+ * whole file is never held in memory, and projects the 3D mesh onto the
+ * 2D model space the renderer uses: an orthographic view down the z axis,
+ * fitted into [-IMPORT_MODELRADIUS, IMPORT_MODELRADIUS] like the built-in
+ * models. Triangles are sorted back to front for the painter's algorithm
+ * and shaded by how directly they face the viewer.
+ */
+
+/* Half the extent of the model space imported meshes are fitted into */
+#define IMPORT_MODELRADIUS  500
+
+/* Size of the chunks the importer reads files in */
+#define IMPORT_CHUNKSIZE    65536
+
+/*
+ * Import a Wavefront OBJ file. Faces with more than three corners are
+ * triangulated as fans. Returns NULL on error.
+ */
+model_t *import_obj(const char *path);
+
+/*
+ * Import a binary STL file. Returns NULL on error.
+ */
+model_t *import_stl(const char *path);
+
+/*
+ * Import a mesh file, choosing the format from its extension (.obj or .stl).
+ */
+model_t *import_model(const char *path);
+
+#endif /*IMPORT_H_*/
@@ -1,26 +1,158 @@
 /*
- * Singly linked list implementation with a simple iterator interface.
+ * Singly linked list implementation with a simple iterator interface
+ * and an optional slab allocator for its nodes.
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "list.h"
 
-/* Internal list node and list definitions. */
-
-typedef struct listnode listnode_t;
-
-struct listnode {
-    listnode_t  *next;
-    void        *item;
-};
+/* Internal list definitions; the node layout lives in list.h. */
 
 struct list {
     listnode_t *head;
     int numitems;
+    listpool_t *pool;
+};
+
+/* A slab is a header followed directly by its array of nodes. */
+typedef struct listslab listslab_t;
+
+struct listslab {
+    listslab_t  *next;
+    listnode_t  nodes[];
 };
 
-/* Return a newly created, empty list. */
-list_t *list_create(void)
+struct listpool {
+    listslab_t  *slabs;
+    listnode_t  *freelist;
+    int         nodesperslab;
+    listpool_stats_t stats;
+};
+
+/* Allocate a fresh slab and thread all of its nodes onto the free list. */
+static int listpool_grow(listpool_t *pool)
+{
+    listslab_t *slab;
+    int i;
+
+    slab = malloc(sizeof(*slab) + sizeof(listnode_t) * pool->nodesperslab);
+    if (!slab) {
+        return 0;
+    }
+
+    /* Link back to front so nodes are handed out in address order. */
+    for (i = pool->nodesperslab - 1; i >= 0; i--) {
+        slab->nodes[i].next = pool->freelist;
+        slab->nodes[i].item = NULL;
+        pool->freelist = &slab->nodes[i];
+    }
+
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->stats.numslabs++;
+    pool->stats.capacity += pool->nodesperslab;
+
+    return 1;
+}
+
+/* Return a newly created node pool that grows by nodesperslab nodes at a time. */
+listpool_t *listpool_create(int nodesperslab)
+{
+    listpool_t *pool;
+
+    if (nodesperslab <= 0) {
+        return NULL;
+    }
+
+    pool = malloc(sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->slabs = NULL;
+    pool->freelist = NULL;
+    pool->nodesperslab = nodesperslab;
+    memset(&pool->stats, 0, sizeof(pool->stats));
+
+    return pool;
+}
+
+/* Free the pool and all its slabs. */
+void listpool_destroy(listpool_t *pool)
+{
+    listslab_t *slab;
+
+    if (!pool) {
+        return;
+    }
+
+    slab = pool->slabs;
+    while (slab) {
+        listslab_t *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    free(pool);
+}
+
+/* Copy the current allocator statistics of the pool. */
+void listpool_getstats(listpool_t *pool, listpool_stats_t *stats)
+{
+    if (!pool || !stats) {
+        return;
+    }
+
+    *stats = pool->stats;
+}
+
+/* Get a node from the list's pool, or from malloc when it has none. */
+static listnode_t *list_allocnode(list_t *list)
+{
+    listpool_t *pool = list->pool;
+    listnode_t *node;
+
+    if (!pool) {
+        return malloc(sizeof(listnode_t));
+    }
+
+    if (!pool->freelist && !listpool_grow(pool)) {
+        return NULL;
+    }
+
+    node = pool->freelist;
+    pool->freelist = node->next;
+
+    pool->stats.allocs++;
+    pool->stats.inuse++;
+    if (pool->stats.inuse > pool->stats.peak) {
+        pool->stats.peak = pool->stats.inuse;
+    }
+
+    return node;
+}
+
+/* Give a node back to where list_allocnode got it from. */
+static void list_freenode(list_t *list, listnode_t *node)
+{
+    listpool_t *pool = list->pool;
+
+    if (!pool) {
+        free(node);
+        return;
+    }
+
+    node->item = NULL;
+    node->next = pool->freelist;
+    pool->freelist = node;
+
+    pool->stats.frees++;
+    pool->stats.inuse--;
+}
+
+/* Return a newly created, empty list, optionally backed by a node pool. */
+list_t *list_create(listpool_t *pool)
 {
     list_t *list = malloc(sizeof(*list));
 
@@ -30,6 +162,7 @@ list_t *list_create(void)
 
     list->head = NULL;
     list->numitems = 0;
+    list->pool = pool;
 
     return list;
 }
@@ -46,7 +179,7 @@ void list_destroy(list_t *list)
     node = list->head;
     while (node) {
         listnode_t *next = node->next;
-        free(node);
+        list_freenode(list, node);
         node = next;
     }
 
@@ -62,7 +195,7 @@ void list_addfirst(list_t *list, void *item)
         return;
     }
 
-    node = malloc(sizeof(*node));
+    node = list_allocnode(list);
     if (!node) {
         return;
     }
@@ -95,7 +228,7 @@ void list_addlast(list_t *list, void *item)
         tail = tail->next;
     }
 
-    node = malloc(sizeof(*node));
+    node = list_allocnode(list);
     if (!node) {
         return;
     }
@@ -128,7 +261,7 @@ void list_remove(list_t *list, void *item)
             }
 
             /* Unlink the node; stored item lifetime is managed by caller. */
-            free(node);
+            list_freenode(list, node);
             list->numitems--;
             return;
         }
@@ -147,10 +280,19 @@ int list_size(list_t *list)
 
 
 /* Iterator implementation */
- struct list_iterator {
-    listnode_t *next;
-    list_t *list;
-};
+
+/* Point a caller-owned iterator at the first item in the list. */
+void list_inititerator(list_iterator_t *iter, list_t *list)
+{
+    if (!iter) {
+        return;
+    }
+
+    iter->list = list;
+    iter->next = list ? list->head : NULL;
+    iter->current = NULL;
+    iter->prev = NULL;
+}
 
 
 /* Return a newly created list iterator for the given list. */
@@ -162,8 +304,7 @@ list_iterator_t *list_createiterator(list_t *list)
         return NULL;
     }
 
-    iter->list = list;
-    iter->next = list ? list->head : NULL;
+    list_inititerator(iter, list);
 
     return iter;
 }
@@ -176,19 +317,25 @@ void list_destroyiterator(list_iterator_t *iter)
 }
 
 
-/* Move iterator to next item in list and return the current item. */
-void *list_next(list_iterator_t *iter)
+/* Unlink the item last returned by list_next, using the tracked predecessor. */
+void list_removecurrent(list_iterator_t *iter)
 {
-    listnode_t *current;
+    list_t *list;
 
-    if (!iter || !iter->next) {
-        return NULL;
+    if (!iter || !iter->current || !iter->list) {
+        return;
     }
 
-    current = iter->next;
-    iter->next = current->next; /* Advance before returning to allow safe removal. */
+    list = iter->list;
+    if (iter->prev) {
+        iter->prev->next = iter->next;
+    } else {
+        list->head = iter->next;
+    }
 
-    return current->item;
+    list_freenode(list, iter->current);
+    list->numitems--;
+    iter->current = NULL;
 }
 
 
@@ -199,5 +346,5 @@ void list_resetiterator(list_iterator_t *iter)
         return;
     }
 
-    iter->next = iter->list ? iter->list->head : NULL;
+    list_inititerator(iter, iter->list);
 }
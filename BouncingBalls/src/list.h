@@ -1,6 +1,8 @@
 #ifndef LIST_H_
 #define LIST_H_
 
+#include <stddef.h>
+
 /*
  * List interface
  */
@@ -8,10 +10,14 @@
 struct list;
 typedef struct list list_t;
 
+struct listpool;
+typedef struct listpool listpool_t;
+
 /*
  * Returns a newly created, empty list.
+ * Nodes are taken from pool when one is given, otherwise from malloc.
  */
-list_t *list_create(void);
+list_t *list_create(listpool_t *pool);
 
 /*
  * Frees the list; list and nodes, but not the items it holds.
@@ -41,11 +47,41 @@ int list_size(list_t *list);
 
 /*
  * List iterator interface
+ *
+ * An iterator is a small struct that may live on the stack; initialise it
+ * with list_inititerator() and traverse with list_next() or list_foreach(),
+ * neither of which allocates. The node and iterator layouts are public only
+ * so that list_next() can be inlined; do not touch their fields directly.
  */
- 
-struct list_iterator;
+
+typedef struct listnode listnode_t;
+
+struct listnode {
+    listnode_t  *next;
+    void        *item;
+};
+
 typedef struct list_iterator list_iterator_t;
 
+struct list_iterator {
+    listnode_t  *next;      /* Node returned by the following list_next */
+    listnode_t  *current;   /* Node last returned, NULL if removed */
+    listnode_t  *prev;      /* Node before current, NULL if current is first */
+    list_t      *list;
+};
+
+/*
+ * Iterate item over all items in the list using the iterator struct iter.
+ * The current item may be removed with list_removecurrent(&iter).
+ */
+#define list_foreach(iter, list, item) \
+    for (list_inititerator(&(iter), (list)); ((item) = list_next(&(iter))) != NULL; )
+
+/*
+ * Prepare a caller-owned iterator so it points to the first item in list.
+ */
+void list_inititerator(list_iterator_t *iter, list_t *list);
+
 /*
  * Return a newly created list iterator for the given list.
  */
@@ -59,11 +95,70 @@ void list_destroyiterator(list_iterator_t *iter);
 /*
  * Move iterator to next item in list and return current.
  */
-void *list_next(list_iterator_t *iter);
+static inline void *list_next(list_iterator_t *iter)
+{
+    listnode_t *current;
+
+    if (!iter || !iter->next) {
+        return NULL;
+    }
+
+    /* A removed current node must not become prev. */
+    if (iter->current) {
+        iter->prev = iter->current;
+    }
+
+    current = iter->next;
+    iter->current = current;
+    iter->next = current->next; /* Advance before returning to allow safe removal. */
+
+    return current->item;
+}
+
+/*
+ * Remove the item last returned by list_next in O(1), only freeing the node.
+ * While iterating, use this rather than list_remove for the current item.
+ */
+void list_removecurrent(list_iterator_t *iter);
 
 /*
  * Let iterator point to first item in list again.
  */
 void list_resetiterator(list_iterator_t *iter);
 
+
+/*
+ * List node pool interface
+ *
+ * A pool hands out list nodes from contiguous slabs and recycles freed
+ * nodes through a free list, so add/remove churn does not touch the heap.
+ * A pool may be shared by several lists, and must outlive all of them.
+ */
+
+typedef struct listpool_stats listpool_stats_t;
+
+struct listpool_stats {
+    int numslabs;       /* Number of slabs allocated */
+    int capacity;       /* Total number of nodes in all slabs */
+    int inuse;          /* Nodes currently handed out to lists */
+    int peak;           /* Highest number of nodes in use at once */
+    long allocs;        /* Number of node allocations served */
+    long frees;         /* Number of nodes returned to the pool */
+};
+
+/*
+ * Return a newly created node pool that grows by nodesperslab nodes at a time.
+ */
+listpool_t *listpool_create(int nodesperslab);
+
+/*
+ * Free the pool and all its slabs. Lists using the pool must be destroyed first.
+ */
+void listpool_destroy(listpool_t *pool);
+
+/*
+ * Copy the current allocator statistics of the pool into stats.
+ */
+void listpool_getstats(listpool_t *pool, listpool_stats_t *stats);
+
 #endif /*LIST_H_*/
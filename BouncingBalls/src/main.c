@@ -7,16 +7,24 @@
 #include <limits.h>
 #include <time.h>
 #include <SDL2/SDL.h>
+#include "backend.h"
+#include "config.h"
 #include "drawline.h"
 #include "triangle.h"
-#include "list.h"
-#include "teapot_data.h"
-#include "sphere_data.h"
+#include "ilist.h"
+#include "model.h"
+#include "assetloader.h"
 #include "object.h"
+#include "physics.h"
+#include "profile.h"
+#include "renderstats.h"
+#include "stress.h"
+#include "trace.h"
+#include "workers.h"
 
 /* Two macro's that find the lesser or greater of two values */
-#define MIN(x,y) (x < y ? x : y)
-#define MAX(x,y) (x > y ? x : y)
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
 
 /*
  * Clear the surface by filling it with 0x00000000(black).
@@ -54,202 +62,300 @@ void accelerate_object(object_t *a, float boost, float maxspeed)
     a->speedy *= news/s;
 }
 /*
- * Animate bouncing balls on the screen.
+ * Report a model that failed to load in the background.
  */
-void bouncing_balls(SDL_Window *window)
+void model_ready(model_t *model, int ok, void *arg)
 {
-    srand((unsigned int)time(NULL));
-    SDL_Surface *surface = SDL_GetWindowSurface(window);
-    if (!surface) {
-        fprintf(stderr, "Unable to get window surface: %s\n", SDL_GetError());
+    (void)model;
+    if (!ok) {
+        fprintf(stderr, "Failed to load %s; run make to generate it.\n", (const char *)arg);
+    }
+}
+
+/*
+ * Animate bouncing balls on the backend's surface as configured. Stops
+ * after config->frames frames if that is positive, otherwise when every
+ * ball has expired.
+ */
+void bouncing_balls(backend_t *backend, const config_t *config)
+{
+    srand(config->seed);
+    SDL_Surface *surface = backend_surface(backend);
+    /* Intrusive list of all ball objects; links live inside each object */
+    ilist_t balls;
+    ilist_init(&balls);
+    /* Schedules the removal of settled balls, so frames only visit those that expire */
+    timerwheel_t *expiry = timerwheel_create(backend_ticks(backend));
+    if (!expiry) {
+        fprintf(stderr, "Failed to create expiry timer wheel.\n");
+        return;
+    }
+    /* Scratch memory for transient render data, reset every frame */
+    arena_t *frame = arena_create(256 * 1024);
+    if (!frame) {
+        fprintf(stderr, "Failed to create frame arena.\n");
+        timerwheel_destroy(expiry);
         return;
     }
-    /* Create list to hold all ball objects */
-    list_t *balls = list_create();
-    if (!balls) {
-        fprintf(stderr, "Failed to create ball list.\n");
+    /* Threads sharing the physics step; the main thread is one of them */
+    workers_t *workers = workers_create(config->threads);
+    if (!workers) {
+        fprintf(stderr, "Failed to create %d worker threads.\n", config->threads);
+        timerwheel_destroy(expiry);
+        arena_destroy(frame);
         return;
     }
-    /* Remove balls 5 seconds after they have settled on the ground */
-    const unsigned int BALL_TTL = 5000;
-    const float REST_SPEED = 0.50f;
-    /* Spawn 10 balls with random speeds */
-    const int NUM_BALLS = 10;
-    for (int i = 0; i < NUM_BALLS; i++) {
-        object_t *ball = create_object(surface, sphere_model, SPHERE_NUMTRIANGLES);
+    /* Load the ball model in the background; balls start out as placeholders */
+    assetloader_t *loader = assetloader_create();
+    if (!loader) {
+        fprintf(stderr, "Failed to create asset loader.\n");
+        workers_destroy(workers);
+        timerwheel_destroy(expiry);
+        arena_destroy(frame);
+        return;
+    }
+    model_t *model = assetloader_request(loader, config->model, model_ready, (void *)config->model);
+    if (!model) {
+        fprintf(stderr, "Failed to request model %s.\n", config->model);
+        assetloader_destroy(loader);
+        workers_destroy(workers);
+        timerwheel_destroy(expiry);
+        arena_destroy(frame);
+        return;
+    }
+    if (!object_reservepool(config->balls)) {
+        fprintf(stderr, "Failed to reserve ball objects.\n");
+    }
+    for (int i = 0; i < config->balls; i++) {
+        object_t *ball = create_object(surface, model);
         if (!ball) {
             fprintf(stderr, "Failed to create ball %d\n", i);
             continue;
         }
         /* Give each ball random size, position, and speed */
-        ball->scale  = 0.15f + ((float)rand() / (float)RAND_MAX) * 0.15f;  
-        int usable_w = MAX(1, surface->w - 200);
-        int usable_h = MAX(1, surface->h / 3);
-        ball->tx     = (float)(rand() % usable_w) + 100.0f;
-        ball->ty     = (float)(rand() % usable_h) + 50.0f;
-        ball->speedx = ((float)rand() / (float)RAND_MAX) * 100.0f - 50.0f; 
-        ball->speedy = ((float)rand() / (float)RAND_MAX) * 80.0f  - 60.0f; 
+        physics_launch(ball, surface->w, surface->h);
         /* TTL starts when the ball comes to rest */
         ball->ttl = 0;
-        list_addlast(balls, ball);
+        ilist_addlast(&balls, &ball->link);
     }
 
     /* Physics constants */
-    const float GRAVITY = 0.35f;
-    const float AIR     = 0.985f; 
-    const float BOUNCE  = 0.78f; 
+    physics_t physics;
+    physics.gravity = config->gravity;
+    physics.air = config->air;
+    physics.bounce = config->bounce;
+    physics.restspeed = config->restspeed;
+    physics.width = surface->w;
+    physics.height = surface->h;
+
+    /* Per-frame render counters, logged as CSV when asked for */
+    FILE *statsfile = NULL;
+    renderstats_t *renderstats = NULL;
+    long totalpixels = 0, totalcovered = 0;
+    if (config->stats[0]) {
+        statsfile = fopen(config->stats, "w");
+        renderstats = renderstats_create(surface->w, surface->h);
+        if (!statsfile || !renderstats) {
+            fprintf(stderr, "Unable to log render counters to %s\n", config->stats);
+            if (statsfile) {
+                fclose(statsfile);
+                statsfile = NULL;
+            }
+            renderstats_destroy(renderstats);
+            renderstats = NULL;
+        } else {
+            renderstats_csvheader(statsfile);
+        }
+    }
+
+    drawcontext_t context;
+    context.frame = frame;
+    context.rasterizer = config->rasterizer;
+    context.stats = renderstats;
+    context.lodpixels = config->lodpixels;
+    context.lodhysteresis = config->lodhysteresis;
+    context.impostorpixels = config->impostor;
+
+    /* Offscreen frames are the output, so never render placeholders into them */
+    if (backend_type(backend) == BACKEND_HEADLESS) {
+        while (assetloader_pending(loader) > 0) {
+            assetloader_poll(loader);
+            SDL_Delay(1);
+        }
+    }
+
+    profile_enable(config->profile);
 
     /* Main animation loop */
-    do {
-        int running = 1;
-        list_iterator_t *it = list_createiterator(balls);
-        if (!it) {
-            list_iterator_t *tmp = list_createiterator(balls);
-            object_t *bf;
-            while (tmp && (bf = list_next(tmp)) != NULL)
-                destroy_object(bf);
-            if (tmp) 
-            list_destroyiterator(tmp);
-            list_destroy(balls);
-            break;
+    int running = 1;
+    int frames = 0;
+    while (running) {
+        profile_beginframe();
+        TRACE_BEGIN(tframe);
+
+        /* Everything allocated from the arena last frame is dead now */
+        arena_reset(frame);
+
+        /* Handle input events */
+        running = backend_poll(backend);
+
+        /* Swap in any models that finished loading since the last frame */
+        assetloader_poll(loader);
+
+        TRACE_BEGIN(tclear);
+        PROFILE_BEGIN(clear);
+        clear_screen(surface);
+        PROFILE_END(PROFILE_CLEAR, clear);
+        TRACE_END("clear", tclear);
+        unsigned int current = backend_ticks(backend);
+
+        TRACE_BEGIN(tstep);
+        PROFILE_BEGIN(step);
+        /* Remove balls whose lifetime after settling has expired */
+        wheeltimer_t *timer;
+        while ((timer = timerwheel_expire(expiry, current)) != NULL) {
+            object_t *ball = wheeltimer_entry(timer, object_t, expiry);
+            ilist_remove(&balls, &ball->link);
+            destroy_object(ball);
         }
-        while (running) {
-            /* Handle input events */
-            SDL_Event e;
-            while (SDL_PollEvent(&e)) {
-                if (e.type == SDL_QUIT)
-                    running = 0;
-                if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)
-                    running = 0;
-            }
-            clear_screen(surface);
-            unsigned int current = SDL_GetTicks();
-
-            /* Update and draw each ball */
-            object_t *ball;
-            while ((ball = list_next(it)) != NULL) {
-                /* Remove balls whose lifetime after settling has expired */
-                if (ball->ttl > 0 && current >= ball->ttl) {
-                    list_remove(balls, ball);
-                    destroy_object(ball);
-                    continue;
-                }
-                int r = (int)((500.0f * ball->scale) + 10.0f);
-
-                /* Update physics */
-                ball->speedy += GRAVITY;
-                ball->speedx *= AIR;
-                ball->speedy *= AIR;
-                ball->tx += ball->speedx;
-                ball->ty += ball->speedy;
-
-                /* Handle collisions with walls */
-                if (ball->tx - r < 0) {
-                    ball->tx = r;
-                    ball->speedx = -ball->speedx * BOUNCE;
-                }
-                if (ball->tx + r > surface->w) {
-                    ball->tx = surface->w - r;
-                    ball->speedx = -ball->speedx * BOUNCE;
-                }
-                if (ball->ty - r < 0) {
-                    ball->ty = r;
-                    ball->speedy = -ball->speedy * BOUNCE;
-                }
-                if (ball->ty + r > surface->h) {
-                    ball->ty = surface->h - r;
-                    ball->speedy = -ball->speedy * BOUNCE;
+
+        /* Move every ball; each step only touches its own ball */
+        workers_run(workers, object_count(), physics_stepslice, &physics);
+        PROFILE_END(PROFILE_PHYSICS, step);
+        TRACE_END("physics", tstep);
+
+        if (renderstats) {
+            renderstats_beginframe(renderstats);
+        }
+
+        /* Start or cancel TTLs and draw each ball */
+        TRACE_BEGIN(tdraw);
+        ilink_t *link;
+        ilist_foreach(&balls, link) {
+            object_t *ball = ilist_entry(link, object_t, link);
+
+            if (ball->resting) {
+                if (ball->ttl == 0) {
+                    ball->ttl = current + config->ttl;
+                    timerwheel_schedule(expiry, &ball->expiry, ball->ttl);
                 }
-                /* If the ball is resting on the ground, stop its motion and start/maintain TTL. */
-                int ground = (ball->ty + r >= surface->h - 1);
-                int resting = ground &&
-                              fabsf(ball->speedx) < REST_SPEED &&
-                              fabsf(ball->speedy) < REST_SPEED;
-                if (resting) {
-                    ball->speedx = 0.0f;
-                    ball->speedy = 0.0f;
-                    ball->ty = surface->h - r;
-                    if (ball->ttl == 0) {
-                        ball->ttl = current + BALL_TTL;
-                    }
-                } else if (ball->ttl != 0) {
-                    ball->ttl = 0;
-                } else {
-                    /* Ball is still moving */
-                }   
-                draw_object(ball);
-            }
+            } else if (ball->ttl != 0) {
+                /* Ball woke up again; its removal is off */
+                ball->ttl = 0;
+                timerwheel_cancel(&ball->expiry);
+            } else {
+                /* Ball is still moving */
+            }   
+            draw_object(ball, &context);
+        }
+        TRACE_END("draw", tdraw);
 
-            /* If no balls remain, stop the animation loop */
-            if (list_size(balls) == 0) {
-                running = 0;
-            }
+        if (renderstats) {
+            renderstats_endframe(renderstats);
+            renderstats_csvrow(statsfile, frames, renderstats);
+            totalpixels += renderstats->pixels;
+            totalcovered += renderstats->covered;
+        }
 
-            /* Reset iterator for next frame */
-            list_resetiterator(it);
-            SDL_UpdateWindowSurface(window);
-            SDL_Delay(1);
+        /* If no balls remain, stop the animation loop */
+        if (ilist_size(&balls) == 0) {
+            running = 0;
         }
-        /* Cleanup */
-        list_iterator_t *it2 = list_createiterator(balls);
-        if (it2) {
-            object_t *b2;
-            while ((b2 = list_next(it2)) != NULL)
-                destroy_object(b2);
-            list_destroyiterator(it2);
+        if (++frames == config->frames) {
+            running = 0;
+        }
+
+        if (config->hud) {
+            profile_drawhud(surface);
         }
-        list_destroyiterator(it);
-        list_destroy(balls);
-    } while (0);
+
+        TRACE_BEGIN(tpresent);
+        PROFILE_BEGIN(present);
+        backend_present(backend);
+        PROFILE_END(PROFILE_PRESENT, present);
+        TRACE_END("present", tpresent);
+
+        profile_endframe();
+        TRACE_END("frame", tframe);
+    }
+
+    if (config->profile) {
+        profile_dump(stdout);
+    }
+
+    /* Report how well the object pool absorbed spawn/expire churn */
+    objectpool_stats_t stats;
+    object_getpoolstats(&stats);
+    printf("Object pool: %d allocated, high-water mark %d, %ld spawns reused, %ld heap allocations\n",
+           stats.capacity, stats.highwater, stats.reused, stats.heapallocs);
+
+    arena_stats_t astats;
+    arena_getstats(frame, &astats);
+    printf("Frame arena: %zu bytes, high-water mark %zu, %ld overflows\n",
+           astats.capacity, astats.highwater, astats.overflows);
+
+    if (renderstats) {
+        printf("Render counters: %d frames logged to %s, overall overdraw %.3f\n",
+               frames, config->stats, totalcovered > 0 ? (double)totalpixels / totalcovered : 0.0);
+        renderstats_destroy(renderstats);
+        fclose(statsfile);
+    }
+
+    /* Cleanup; the object store owns every ball still in the list */
+    destroy_all_objects();
+    assetloader_destroy(loader);
+    workers_destroy(workers);
+    timerwheel_destroy(expiry);
+    arena_destroy(frame);
+    model_destroy(model);
 }
 /*
  * Main program entry point
  */
-int main(void)
+int main(int argc, char **argv)
 {
-    const size_t bufsize = 100;
-    
-    /* Change the screen width and height to your own liking */
-    const int screen_w = 1600;
-    const int screen_h = 900;
+    config_t config;
+    backend_t *backend;
+
+    /* Defaults, overridden by a config file and the command line */
+    config_default(&config);
+    if (!config_parse(&config, argc, argv)) {
+        return EXIT_FAILURE;
+    }
+    config_print(&config, stdout);
 
-    char errmsg[bufsize];
-    SDL_Window *window;
+    /* The stress ramp creates its own headless surfaces */
+    if (config.stress[0]) {
+        return stress_run(&config) ? 0 : EXIT_FAILURE;
+    }
 
-    /* Initialize SDL */
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        snprintf(errmsg, bufsize, "Unable to initialize SDL.");
-        goto error;
+    /* Tracing has to start before the worker threads do */
+    if (config.trace[0]) {
+        trace_start();
+        trace_threadname("main");
     }
-    
-    /* Create a 1600x900 window */
-    window = SDL_CreateWindow("The Amazing Bouncing Balls",
-                              SDL_WINDOWPOS_UNDEFINED,
-                              SDL_WINDOWPOS_UNDEFINED,
-                              screen_w, screen_h,
-                              0);
-    if(!window) {
-        snprintf(errmsg, bufsize, "Unable to get video surface.");
-        goto error;
+
+    /* Create the window, or an offscreen surface of the same size */
+    backend = backend_create(config.backend, config.width, config.height, "The Amazing Bouncing Balls");
+    if (!backend) {
+        exit(EXIT_FAILURE);
     }
 
     /* Start bouncing some balls */
-    bouncing_balls(window);
+    bouncing_balls(backend, &config);
+
+    /* Every worker thread has been joined by now */
+    if (config.trace[0]) {
+        trace_write(config.trace);
+    }
 
-    /* Destroy the window now that we're done */
-    if (window) {
-        SDL_DestroyWindow(window);
-        window = NULL;
+    /* Keep the last frame when rendering in batch */
+    if (config.output[0] && SDL_SaveBMP(backend_surface(backend), config.output) < 0) {
+        fprintf(stderr, "Unable to save %s. Error returned: %s\n", config.output, SDL_GetError());
     }
 
-    /* Shut down SDL */
-    SDL_Quit();
+    /* Destroy the window and shut down SDL now that we're done */
+    backend_destroy(backend);
 
     return 0;
-
-    /* Upon an error, print message and quit properly */
-error:
-    fprintf(stderr, "%s Error returned: %s\n", errmsg, SDL_GetError());
-    SDL_Quit();
-    exit(EXIT_FAILURE);
 }
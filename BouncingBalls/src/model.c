@@ -0,0 +1,985 @@
+/*
+ * Model module: packing triangle meshes into their shared, compact form,
+ * and saving and mapping them as binary model files.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <math.h>
+#include "model.h"
+
+/* Cell size of the first coarser level, as a fraction of the model radius */
+#define LOD_FIRSTCELL       32
+
+/* Smallest level worth keeping, and the least a level must drop, in tenths */
+#define LOD_MINTRIANGLES    8
+#define LOD_MAXKEPT         9
+
+/* Cells across the model radius when comparing outlines */
+#define LOD_OUTLINECELLS    256
+
+/* Distance from the origin of the farthest possible corner, rounded up */
+#define BOUNDS_MAXRADIUS    46341
+
+/* Return 1 if v can be stored in a Sint16 model coordinate. */
+static int fits_int16(int v)
+{
+    return v >= -32768 && v <= 32767;
+}
+
+/* Return channel (16 = red, 8 = green, 0 = blue) of a 24-bit color. */
+static int channel(Uint32 color, int shift)
+{
+    return (int)((color >> shift) & 0xff);
+}
+
+/*
+ * Build an exact palette if the mesh has at most MODEL_MAXCOLORS distinct
+ * colors. Return 0 if it has more.
+ */
+static int build_exact_palette(model_t *model, const triangle_t *triangles)
+{
+    int i, k;
+
+    model->numcolors = 0;
+    for (i = 0; i < model->numtriangles; i++) {
+        Uint32 color = triangles[i].fillcolor & 0xffffff;
+
+        for (k = 0; k < model->numcolors; k++) {
+            if (model->palette[k] == color) {
+                break;
+            }
+        }
+        if (k == model->numcolors) {
+            if (k == MODEL_MAXCOLORS) {
+                return 0;
+            }
+            model->palette[model->numcolors++] = color;
+        }
+        model->triangles[i].color = (Uint8)k;
+    }
+
+    return 1;
+}
+
+/* Colors and channel used by compare_channel while sorting a median-cut box. */
+static const triangle_t *sort_triangles;
+static int sort_shift;
+
+/* qsort comparator ordering triangle indices by one color channel. */
+static int compare_channel(const void *a, const void *b)
+{
+    int ca = channel(sort_triangles[*(const int *)a].fillcolor, sort_shift);
+    int cb = channel(sort_triangles[*(const int *)b].fillcolor, sort_shift);
+
+    return ca - cb;
+}
+
+/*
+ * Quantize the mesh colors to MODEL_MAXCOLORS with median cut: repeatedly
+ * split the box of triangles with the widest channel range at its median,
+ * then use the average color of each box as its palette entry.
+ */
+static int build_quantized_palette(model_t *model, const triangle_t *triangles)
+{
+    int starts[MODEL_MAXCOLORS + 1];
+    int numboxes = 1;
+    int *order;
+    int i, k;
+
+    order = malloc(sizeof(int) * model->numtriangles);
+    if (!order) {
+        return 0;
+    }
+    for (i = 0; i < model->numtriangles; i++) {
+        order[i] = i;
+    }
+    starts[0] = 0;
+    starts[1] = model->numtriangles;
+
+    while (numboxes < MODEL_MAXCOLORS) {
+        int best = -1, bestshift = 0, bestrange = 0;
+        int shift, mid;
+
+        /* Find the box and channel with the widest spread of values. */
+        for (k = 0; k < numboxes; k++) {
+            for (shift = 0; shift <= 16; shift += 8) {
+                int lo = 255, hi = 0;
+
+                for (i = starts[k]; i < starts[k + 1]; i++) {
+                    int c = channel(triangles[order[i]].fillcolor, shift);
+                    lo = c < lo ? c : lo;
+                    hi = c > hi ? c : hi;
+                }
+                if (hi - lo > bestrange) {
+                    best = k;
+                    bestshift = shift;
+                    bestrange = hi - lo;
+                }
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        sort_triangles = triangles;
+        sort_shift = bestshift;
+        qsort(order + starts[best], starts[best + 1] - starts[best], sizeof(int), compare_channel);
+
+        /* Insert the median as a new box boundary. */
+        mid = starts[best] + (starts[best + 1] - starts[best]) / 2;
+        memmove(&starts[best + 2], &starts[best + 1], sizeof(int) * (numboxes - best));
+        starts[best + 1] = mid;
+        numboxes++;
+    }
+
+    for (k = 0; k < numboxes; k++) {
+        unsigned long r = 0, g = 0, b = 0;
+        unsigned long n = (unsigned long)(starts[k + 1] - starts[k]);
+
+        for (i = starts[k]; i < starts[k + 1]; i++) {
+            Uint32 color = triangles[order[i]].fillcolor;
+            r += channel(color, 16);
+            g += channel(color, 8);
+            b += channel(color, 0);
+            model->triangles[order[i]].color = (Uint8)k;
+        }
+        model->palette[k] = (Uint32)((r / n) << 16 | (g / n) << 8 | (b / n));
+    }
+    model->numcolors = numboxes;
+
+    free(order);
+
+    return 1;
+}
+
+/* Return the squared distance of (x, y) from the model origin. */
+static long long distance2(int x, int y)
+{
+    return (long long)x * x + (long long)y * y;
+}
+
+/* Grow the bounds to hold the corner (x, y). */
+static void bound_corner(modelbounds_t *bounds, int x, int y, long long *radius2)
+{
+    long long d = distance2(x, y);
+
+    bounds->minx = x < bounds->minx ? x : bounds->minx;
+    bounds->maxx = x > bounds->maxx ? x : bounds->maxx;
+    bounds->miny = y < bounds->miny ? y : bounds->miny;
+    bounds->maxy = y > bounds->maxy ? y : bounds->maxy;
+    *radius2 = d > *radius2 ? d : *radius2;
+}
+
+/* Set the model's bounds from the corners of every level of detail. */
+static void compute_bounds(model_t *model)
+{
+    modelbounds_t *bounds = &model->bounds;
+    long long radius2 = 0;
+    int level, i;
+
+    bounds->minx = bounds->miny = INT_MAX;
+    bounds->maxx = bounds->maxy = INT_MIN;
+    for (level = 0; level < model->numlods; level++) {
+        const modellod_t *lod = &model->lods[level];
+
+        for (i = 0; i < lod->numtriangles; i++) {
+            const modeltri_t *tri = &lod->triangles[i];
+
+            bound_corner(bounds, tri->x1, tri->y1, &radius2);
+            bound_corner(bounds, tri->x2, tri->y2, &radius2);
+            bound_corner(bounds, tri->x3, tri->y3, &radius2);
+        }
+    }
+    bounds->radius = (int)ceil(sqrt((double)radius2));
+}
+
+/* Return a newly created model packed from an array of triangle_t. */
+model_t *model_create(const triangle_t *triangles, int numtriangles)
+{
+    model_t *model;
+    int i;
+
+    if (!triangles || numtriangles <= 0) {
+        return NULL;
+    }
+
+    model = malloc(sizeof(*model));
+    if (!model) {
+        return NULL;
+    }
+
+    model->mapping = NULL;
+    model->numlods = 0;
+    model->radius = 0;
+    model->numbands = 0;
+    model->triangles = malloc(sizeof(modeltri_t) * numtriangles);
+    model->palette = malloc(sizeof(Uint32) * MODEL_MAXCOLORS);
+    if (!model->triangles || !model->palette) {
+        model_destroy(model);
+        return NULL;
+    }
+    model->numtriangles = numtriangles;
+    model->numcolors = 0;
+    model->flags = 0;
+    model->mappingsize = 0;
+
+    for (i = 0; i < numtriangles; i++) {
+        const triangle_t *src = &triangles[i];
+        modeltri_t *dst = &model->triangles[i];
+
+        if (!fits_int16(src->x1) || !fits_int16(src->y1) ||
+            !fits_int16(src->x2) || !fits_int16(src->y2) ||
+            !fits_int16(src->x3) || !fits_int16(src->y3)) {
+            fprintf(stderr, "Model triangle %d does not fit in 16-bit coordinates\n", i);
+            model_destroy(model);
+            return NULL;
+        }
+
+        dst->x1 = (Sint16)src->x1;
+        dst->y1 = (Sint16)src->y1;
+        dst->x2 = (Sint16)src->x2;
+        dst->y2 = (Sint16)src->y2;
+        dst->x3 = (Sint16)src->x3;
+        dst->y3 = (Sint16)src->y3;
+        dst->pad = 0;
+    }
+
+    /* Exact colors when they fit, otherwise quantize. */
+    if (!build_exact_palette(model, triangles) &&
+        !build_quantized_palette(model, triangles)) {
+        model_destroy(model);
+        return NULL;
+    }
+
+    model->numlods = 1;
+    model->lods[0].numtriangles = numtriangles;
+    model->lods[0].triangles = model->triangles;
+    model->lods[0].error = 0;
+    compute_bounds(model);
+
+    return model;
+}
+
+typedef struct cornerref cornerref_t;
+
+/* A triangle corner and the grid cell it falls in, for clustering */
+struct cornerref {
+    int cx, cy;         /* Grid cell */
+    int x, y;           /* Corner position */
+    int index;          /* 3 * triangle + corner */
+};
+
+typedef struct trikey trikey_t;
+
+/* A triangle's corners in sorted order, for finding duplicates */
+struct trikey {
+    int corners[6];
+    int index;
+};
+
+/* Return v / d rounded towards negative infinity, for d > 0. */
+static int floor_div(int v, int d)
+{
+    return v >= 0 ? v / d : -((-v + d - 1) / d);
+}
+
+/* qsort comparator ordering corners by grid cell, then by corner index. */
+static int compare_cell(const void *a, const void *b)
+{
+    const cornerref_t *ca = a, *cb = b;
+
+    if (ca->cx != cb->cx) {
+        return ca->cx < cb->cx ? -1 : 1;
+    }
+    if (ca->cy != cb->cy) {
+        return ca->cy < cb->cy ? -1 : 1;
+    }
+    return ca->index - cb->index;
+}
+
+/* qsort comparator ordering triangle keys by corners, then by triangle index. */
+static int compare_trikey(const void *a, const void *b)
+{
+    const trikey_t *ka = a, *kb = b;
+    int i;
+
+    for (i = 0; i < 6; i++) {
+        if (ka->corners[i] != kb->corners[i]) {
+            return ka->corners[i] < kb->corners[i] ? -1 : 1;
+        }
+    }
+    return ka->index - kb->index;
+}
+
+/* Fill in the key of a triangle, sorting its corners. */
+static void make_trikey(trikey_t *key, const modeltri_t *tri, int index)
+{
+    int pts[3][2] = { { tri->x1, tri->y1 }, { tri->x2, tri->y2 }, { tri->x3, tri->y3 } };
+    int i, k, tx, ty;
+
+    for (i = 1; i < 3; i++) {
+        for (k = i; k > 0 && (pts[k][0] < pts[k - 1][0] ||
+                              (pts[k][0] == pts[k - 1][0] && pts[k][1] < pts[k - 1][1])); k--) {
+            tx = pts[k][0];
+            ty = pts[k][1];
+            pts[k][0] = pts[k - 1][0];
+            pts[k][1] = pts[k - 1][1];
+            pts[k - 1][0] = tx;
+            pts[k - 1][1] = ty;
+        }
+    }
+    for (i = 0; i < 3; i++) {
+        key->corners[2 * i] = pts[i][0];
+        key->corners[2 * i + 1] = pts[i][1];
+    }
+    key->index = index;
+}
+
+/*
+ * Decimate the full mesh with the given grid cell size into lod. Its
+ * triangles keep their draw order; of duplicates only the last, which is
+ * the one drawn on top, is kept.
+ */
+static int decimate(const model_t *model, int cellsize, modellod_t *lod)
+{
+    int n = model->numtriangles;
+    cornerref_t *corners = malloc(sizeof(cornerref_t) * 3 * n);
+    Sint16 *snapped = malloc(sizeof(Sint16) * 6 * n);
+    modeltri_t *out = malloc(sizeof(modeltri_t) * n);
+    trikey_t *keys = malloc(sizeof(trikey_t) * n);
+    char *dead = calloc(n, 1);
+    int i, k, run, best, m;
+
+    if (!corners || !snapped || !out || !keys || !dead) {
+        free(corners);
+        free(snapped);
+        free(out);
+        free(keys);
+        free(dead);
+        return 0;
+    }
+
+    for (i = 0; i < n; i++) {
+        const modeltri_t *tri = &model->triangles[i];
+        int xs[3] = { tri->x1, tri->x2, tri->x3 };
+        int ys[3] = { tri->y1, tri->y2, tri->y3 };
+
+        for (k = 0; k < 3; k++) {
+            cornerref_t *corner = &corners[3 * i + k];
+
+            corner->cx = floor_div(xs[k], cellsize);
+            corner->cy = floor_div(ys[k], cellsize);
+            corner->x = xs[k];
+            corner->y = ys[k];
+            corner->index = 3 * i + k;
+        }
+    }
+    qsort(corners, 3 * n, sizeof(cornerref_t), compare_cell);
+
+    /* Collapse each cell to its corner farthest from the origin */
+    for (run = 0; run < 3 * n; run = k) {
+        best = run;
+        for (k = run + 1; k < 3 * n && corners[k].cx == corners[run].cx &&
+                          corners[k].cy == corners[run].cy; k++) {
+            if (distance2(corners[k].x, corners[k].y) > distance2(corners[best].x, corners[best].y)) {
+                best = k;
+            }
+        }
+        for (i = run; i < k; i++) {
+            snapped[2 * corners[i].index] = (Sint16)corners[best].x;
+            snapped[2 * corners[i].index + 1] = (Sint16)corners[best].y;
+        }
+    }
+
+    /* Rebuild the triangles, dropping the ones that collapsed */
+    m = 0;
+    for (i = 0; i < n; i++) {
+        const Sint16 *c = &snapped[6 * i];
+        long long area2 = (long long)(c[2] - c[0]) * (c[5] - c[1]) -
+                          (long long)(c[4] - c[0]) * (c[3] - c[1]);
+
+        if (area2 == 0) {
+            continue;
+        }
+        out[m].x1 = c[0];
+        out[m].y1 = c[1];
+        out[m].x2 = c[2];
+        out[m].y2 = c[3];
+        out[m].x3 = c[4];
+        out[m].y3 = c[5];
+        out[m].color = model->triangles[i].color;
+        out[m].pad = 0;
+        make_trikey(&keys[m], &out[m], m);
+        m++;
+    }
+
+    /* Of triangles with the same corners, only the last drawn shows */
+    qsort(keys, m, sizeof(trikey_t), compare_trikey);
+    for (i = 0; i + 1 < m; i++) {
+        if (memcmp(keys[i].corners, keys[i + 1].corners, sizeof(keys[i].corners)) == 0) {
+            dead[keys[i].index] = 1;
+        }
+    }
+    for (i = 0, k = 0; i < m; i++) {
+        if (!dead[i]) {
+            out[k++] = out[i];
+        }
+    }
+
+    free(corners);
+    free(snapped);
+    free(keys);
+    free(dead);
+
+    lod->numtriangles = k;
+    lod->triangles = out;
+    lod->error = 0;
+
+    return 1;
+}
+
+/*
+ * Set the cells of a size x size grid whose centers the triangles cover.
+ * Cell (0, 0) is centered on model point (-half * cell, -half * cell).
+ */
+static void cover_triangles(Uint8 *mask, int size, int half, double cell,
+                            const modeltri_t *triangles, int numtriangles)
+{
+    int i, x, y;
+
+    for (i = 0; i < numtriangles; i++) {
+        const modeltri_t *tri = &triangles[i];
+        double x1 = tri->x1 / cell + half, y1 = tri->y1 / cell + half;
+        double x2 = tri->x2 / cell + half, y2 = tri->y2 / cell + half;
+        double x3 = tri->x3 / cell + half, y3 = tri->y3 / cell + half;
+        double area = (x2 - x1) * (y3 - y1) - (x3 - x1) * (y2 - y1);
+        double sign = area < 0.0 ? -1.0 : 1.0;
+        int left = (int)floor(fmin(x1, fmin(x2, x3))), right = (int)ceil(fmax(x1, fmax(x2, x3)));
+        int top = (int)floor(fmin(y1, fmin(y2, y3))), bottom = (int)ceil(fmax(y1, fmax(y2, y3)));
+
+        if (area == 0.0) {
+            continue;
+        }
+        left = left > 0 ? left : 0;
+        top = top > 0 ? top : 0;
+        right = right < size - 1 ? right : size - 1;
+        bottom = bottom < size - 1 ? bottom : size - 1;
+        for (y = top; y <= bottom; y++) {
+            for (x = left; x <= right; x++) {
+                /* Edge functions, all of the area's sign or zero inside */
+                double e1 = ((x2 - x1) * (y - y1) - (x - x1) * (y2 - y1)) * sign;
+                double e2 = ((x3 - x2) * (y - y2) - (x - x2) * (y3 - y2)) * sign;
+                double e3 = ((x1 - x3) * (y - y3) - (x - x3) * (y1 - y3)) * sign;
+
+                if (e1 >= 0.0 && e2 >= 0.0 && e3 >= 0.0) {
+                    mask[y * size + x] = 1;
+                }
+            }
+        }
+    }
+}
+
+/* Keep the neighbour's nearest set cell for (x, y) if it is nearer. */
+static void nearer(int *near, int size, int x, int y, int nx, int ny)
+{
+    int *best = &near[2 * (y * size + x)];
+    const int *other = &near[2 * (ny * size + nx)];
+    long long dx, dy;
+
+    if (nx < 0 || nx >= size || ny < 0 || ny >= size || other[0] == INT_MAX) {
+        return;
+    }
+    dx = other[0] - x;
+    dy = other[1] - y;
+    if (best[0] == INT_MAX ||
+        dx * dx + dy * dy < (long long)(best[0] - x) * (best[0] - x) +
+                            (long long)(best[1] - y) * (best[1] - y)) {
+        best[0] = other[0];
+        best[1] = other[1];
+    }
+}
+
+/*
+ * Return the largest distance in cells from a cell set in from to the
+ * nearest cell set in to, found by passing nearest cells between
+ * neighbours in two sweeps; near is scratch for 2 * size * size ints.
+ */
+static double mask_distance(const Uint8 *from, const Uint8 *to, int *near, int size)
+{
+    double farthest = 0.0;
+    int x, y;
+
+    for (y = 0; y < size; y++) {
+        for (x = 0; x < size; x++) {
+            near[2 * (y * size + x)] = to[y * size + x] ? x : INT_MAX;
+            near[2 * (y * size + x) + 1] = y;
+        }
+    }
+    for (y = 0; y < size; y++) {
+        for (x = 0; x < size; x++) {
+            nearer(near, size, x, y, x - 1, y);
+            nearer(near, size, x, y, x - 1, y - 1);
+            nearer(near, size, x, y, x, y - 1);
+            nearer(near, size, x, y, x + 1, y - 1);
+        }
+        for (x = size - 1; x >= 0; x--) {
+            nearer(near, size, x, y, x + 1, y);
+        }
+    }
+    for (y = size - 1; y >= 0; y--) {
+        for (x = size - 1; x >= 0; x--) {
+            nearer(near, size, x, y, x + 1, y);
+            nearer(near, size, x, y, x + 1, y + 1);
+            nearer(near, size, x, y, x, y + 1);
+            nearer(near, size, x, y, x - 1, y + 1);
+        }
+        for (x = 0; x < size; x++) {
+            nearer(near, size, x, y, x - 1, y);
+        }
+    }
+
+    for (y = 0; y < size; y++) {
+        for (x = 0; x < size; x++) {
+            const int *best = &near[2 * (y * size + x)];
+            double d;
+
+            if (!from[y * size + x] || to[y * size + x] || best[0] == INT_MAX) {
+                continue;
+            }
+            d = sqrt((double)(best[0] - x) * (best[0] - x) + (double)(best[1] - y) * (best[1] - y));
+            farthest = d > farthest ? d : farthest;
+        }
+    }
+
+    return farthest;
+}
+
+/*
+ * Return how far, in model units, the outline of the level strays from
+ * the outline of the full mesh: the farthest a point covered by one of
+ * them lies from the area covered by the other. Triangles inside the
+ * outline are not compared. Returns -1 on error.
+ */
+static int outline_error(const model_t *model, const modellod_t *lod, double extent)
+{
+    double cell = extent / LOD_OUTLINECELLS;
+    int half, size;
+    Uint8 *full, *level;
+    int *near;
+    double error;
+
+    cell = cell > 1.0 ? cell : 1.0;
+    half = (int)ceil(extent / cell) + 1;
+    size = 2 * half + 1;
+    full = calloc((size_t)size * size, 1);
+    level = calloc((size_t)size * size, 1);
+    near = malloc(sizeof(int) * 2 * size * size);
+    if (!full || !level || !near) {
+        free(full);
+        free(level);
+        free(near);
+        return -1;
+    }
+
+    cover_triangles(full, size, half, cell, model->triangles, model->numtriangles);
+    cover_triangles(level, size, half, cell, lod->triangles, lod->numtriangles);
+    error = fmax(mask_distance(full, level, near, size), mask_distance(level, full, near, size));
+
+    free(full);
+    free(level);
+    free(near);
+
+    /* A cell of slack covers where the outline falls between cell centers */
+    return (int)ceil((error + 1.0) * cell);
+}
+
+/* Return the distance from the origin to the model's farthest corner. */
+static double model_extent(const model_t *model)
+{
+    long long radius2 = 0, d;
+    int i;
+
+    for (i = 0; i < model->numtriangles; i++) {
+        const modeltri_t *tri = &model->triangles[i];
+
+        d = distance2(tri->x1, tri->y1);
+        radius2 = d > radius2 ? d : radius2;
+        d = distance2(tri->x2, tri->y2);
+        radius2 = d > radius2 ? d : radius2;
+        d = distance2(tri->x3, tri->y3);
+        radius2 = d > radius2 ? d : radius2;
+    }
+
+    return sqrt((double)radius2);
+}
+
+/* Add coarser levels of detail to the model. */
+int model_buildlods(model_t *model)
+{
+    double extent;
+    int cellsize;
+
+    if (!model || model->mapping) {
+        return 0;
+    }
+
+    extent = model_extent(model);
+    cellsize = (int)(extent / LOD_FIRSTCELL);
+    cellsize = cellsize > 0 ? cellsize : 1;
+
+    while (model->numlods < MODEL_MAXLODS) {
+        modellod_t *prev = &model->lods[model->numlods - 1];
+        modellod_t lod;
+
+        if (!decimate(model, cellsize, &lod)) {
+            return 0;
+        }
+        lod.error = outline_error(model, &lod, extent);
+        if (lod.error < 0) {
+            free(lod.triangles);
+            return 0;
+        }
+        if (lod.numtriangles < LOD_MINTRIANGLES ||
+            lod.numtriangles * 10 > prev->numtriangles * LOD_MAXKEPT) {
+            /* Too coarse, or not worth a level; coarser cells might still reduce */
+            free(lod.triangles);
+            if (lod.numtriangles < LOD_MINTRIANGLES) {
+                break;
+            }
+        } else {
+            model->lods[model->numlods++] = lod;
+        }
+        cellsize *= 2;
+    }
+    compute_bounds(model);
+
+    return 1;
+}
+
+/* Flag the model as a sphere impostor with the given rings. */
+int model_setimpostor(model_t *model, const Uint8 *bands, int numbands)
+{
+    int i;
+
+    if (!model || model->mapping || numbands < 1 || numbands > MODEL_MAXBANDS) {
+        return 0;
+    }
+    for (i = 0; i < numbands; i++) {
+        if (bands[i] >= model->numcolors) {
+            return 0;
+        }
+        model->bands[i] = bands[i];
+    }
+
+    model->numbands = numbands;
+    model->radius = (int)ceil(model_extent(model));
+    model->flags |= MODEL_SPHERE;
+
+    return 1;
+}
+
+/* Return the header size of a model file version; fields were only ever appended. */
+static size_t header_size(int version)
+{
+    if (version >= 4) {
+        return sizeof(modelfile_header_t);
+    }
+    return version == 3 ? offsetof(modelfile_header_t, minx) : offsetof(modelfile_header_t, flags);
+}
+
+/* Return 1 if numtriangles triangles at offset fit in a file of the given size. */
+static int valid_triangles(Uint32 numtriangles, Uint32 offset, size_t headersize, size_t size)
+{
+    return numtriangles > 0 &&
+           numtriangles <= (Uint32)0x7fffffff / sizeof(modeltri_t) &&
+           offset % sizeof(Sint16) == 0 &&
+           offset >= headersize &&
+           (size_t)offset + sizeof(modeltri_t) * numtriangles <= size;
+}
+
+/* Return 1 if the LOD table of a mapped file of the given size is usable. */
+static int valid_lodtable(const void *mapping, Uint32 offset, size_t headersize, size_t size)
+{
+    const Uint32 *count = (const Uint32 *)((const char *)mapping + offset);
+    const modelfile_lod_t *lods = (const modelfile_lod_t *)(count + 1);
+    Uint32 i;
+
+    if (offset % sizeof(Uint32) != 0 || offset < headersize ||
+        (size_t)offset + sizeof(Uint32) > size || *count >= MODEL_MAXLODS ||
+        (size_t)offset + sizeof(Uint32) + sizeof(modelfile_lod_t) * *count > size) {
+        return 0;
+    }
+    for (i = 0; i < *count; i++) {
+        if (!valid_triangles(lods[i].numtriangles, lods[i].triangleoffset, headersize, size) ||
+            lods[i].reserved != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Return 1 if the impostor fields of a version 3 header are usable. */
+static int valid_impostor(const modelfile_header_t *header)
+{
+    if (header->flags & ~(Uint32)MODEL_SPHERE || header->pad != 0) {
+        return 0;
+    }
+    if (!(header->flags & MODEL_SPHERE)) {
+        return 1;
+    }
+    return header->radius > 0 && header->numbands >= 1 && header->numbands <= MODEL_MAXBANDS;
+}
+
+/*
+ * Return 1 if the bounds of a version 4 header are usable. They are only
+ * used to skip or clip whole objects, and the rasterizer still rejects
+ * triangles off the surface, so bounds that are too small draw wrongly
+ * but never out of the surface.
+ */
+static int valid_bounds(const modelfile_header_t *header)
+{
+    return header->minx <= header->maxx && header->miny <= header->maxy && header->pad2 == 0;
+}
+
+/* Return 1 if the mapped file of the given size has a usable header. */
+static int valid_header(const modelfile_header_t *header, size_t size)
+{
+    size_t palettebytes = sizeof(Uint32) * MODEL_MAXCOLORS;
+    size_t headersize;
+
+    if (size < offsetof(modelfile_header_t, flags) + palettebytes) {
+        fprintf(stderr, "Truncated model file\n");
+        return 0;
+    }
+    if (memcmp(header->magic, MODEL_FILEMAGIC, 4) != 0) {
+        fprintf(stderr, "Not a model file\n");
+        return 0;
+    }
+    /* Version 1 lacks levels of detail, versions 1 and 2 impostors, 1 to 3 bounds */
+    headersize = header_size(header->version);
+    if (header->version < 1 || header->version > MODEL_FILEVERSION ||
+        header->headersize != headersize) {
+        fprintf(stderr, "Unsupported model file version %d\n", header->version);
+        return 0;
+    }
+    if (header->filesize != size ||
+        size < headersize + palettebytes ||
+        (header->version == 1 && header->lodoffset != 0) ||
+        (header->version >= 3 && !valid_impostor(header)) ||
+        (header->version >= 4 && !valid_bounds(header)) ||
+        header->numcolors > MODEL_MAXCOLORS ||
+        header->paletteoffset % sizeof(Uint32) != 0 ||
+        header->paletteoffset < headersize ||
+        (size_t)header->paletteoffset + palettebytes > size ||
+        !valid_triangles(header->numtriangles, header->triangleoffset, headersize, size) ||
+        (header->lodoffset != 0 && !valid_lodtable(header, header->lodoffset, headersize, size))) {
+        fprintf(stderr, "Corrupt model file header\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Map a binary model file read-only and return a view of it. */
+model_t *model_load(const char *path)
+{
+    const modelfile_header_t *header;
+    struct stat st;
+    model_t *model;
+    void *mapping;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to open model file %s\n", path);
+        return NULL;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        fprintf(stderr, "Unable to stat model file %s\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Unable to map model file %s\n", path);
+        return NULL;
+    }
+
+    header = mapping;
+    if (!valid_header(header, (size_t)st.st_size)) {
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+
+    model = malloc(sizeof(*model));
+    if (!model) {
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+
+    /* The model is only a view; its arrays point straight into the mapping. */
+    model->numtriangles = (int)header->numtriangles;
+    model->numcolors = (int)header->numcolors;
+    model->palette = (Uint32 *)((char *)mapping + header->paletteoffset);
+    model->flags = 0;
+    model->triangles = (modeltri_t *)((char *)mapping + header->triangleoffset);
+    model->mapping = mapping;
+    model->mappingsize = (size_t)st.st_size;
+
+    model->radius = 0;
+    model->numbands = 0;
+    if (header->version >= 3 && (header->flags & MODEL_SPHERE)) {
+        model->flags = MODEL_SPHERE;
+        model->radius = header->radius;
+        model->numbands = header->numbands;
+        memcpy(model->bands, header->bands, sizeof(model->bands));
+    }
+
+    model->numlods = 1;
+    model->lods[0].numtriangles = model->numtriangles;
+    model->lods[0].triangles = model->triangles;
+    model->lods[0].error = 0;
+    if (header->lodoffset != 0) {
+        const Uint32 *count = (const Uint32 *)((char *)mapping + header->lodoffset);
+        const modelfile_lod_t *lods = (const modelfile_lod_t *)(count + 1);
+        Uint32 i;
+
+        for (i = 0; i < *count; i++) {
+            modellod_t *lod = &model->lods[model->numlods++];
+
+            lod->numtriangles = (int)lods[i].numtriangles;
+            lod->triangles = (modeltri_t *)((char *)mapping + lods[i].triangleoffset);
+            lod->error = (int)lods[i].error;
+        }
+    }
+
+    if (header->version >= 4) {
+        model->bounds.minx = header->minx;
+        model->bounds.miny = header->miny;
+        model->bounds.maxx = header->maxx;
+        model->bounds.maxy = header->maxy;
+        model->bounds.radius = header->boundradius;
+    } else {
+        /* Finding the bounds would read every triangle; cover all of model space instead */
+        model->bounds.minx = model->bounds.miny = -32768;
+        model->bounds.maxx = model->bounds.maxy = 32767;
+        model->bounds.radius = BOUNDS_MAXRADIUS;
+    }
+
+    return model;
+}
+
+/* Write the model to path as a binary model file. */
+int model_save(const model_t *model, const char *path)
+{
+    modelfile_header_t header;
+    modelfile_lod_t lods[MODEL_MAXLODS];
+    Uint32 palette[MODEL_MAXCOLORS];
+    Uint32 numcoarser, offset;
+    FILE *file;
+    int ok, i;
+
+    if (!model || !path) {
+        return 0;
+    }
+
+    /* Unused palette entries are stored as black so the palette is always full. */
+    memset(palette, 0, sizeof(palette));
+    memcpy(palette, model->palette, sizeof(Uint32) * model->numcolors);
+
+    /* Header, palette, full mesh, LOD table, then the coarser meshes */
+    numcoarser = model->numlods > 1 ? (Uint32)(model->numlods - 1) : 0;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MODEL_FILEMAGIC, 4);
+    header.version = MODEL_FILEVERSION;
+    header.headersize = sizeof(header);
+    header.numtriangles = (Uint32)model->numtriangles;
+    header.numcolors = (Uint32)model->numcolors;
+    header.paletteoffset = sizeof(header);
+    header.triangleoffset = sizeof(header) + sizeof(palette);
+    offset = header.triangleoffset + (Uint32)(sizeof(modeltri_t) * model->numtriangles);
+    if (numcoarser > 0) {
+        header.lodoffset = offset;
+        offset += (Uint32)(sizeof(Uint32) + sizeof(modelfile_lod_t) * numcoarser);
+        memset(lods, 0, sizeof(lods));
+        for (i = 0; i < (int)numcoarser; i++) {
+            const modellod_t *lod = &model->lods[i + 1];
+
+            lods[i].numtriangles = (Uint32)lod->numtriangles;
+            lods[i].triangleoffset = offset;
+            lods[i].error = (Uint32)lod->error;
+            offset += (Uint32)(sizeof(modeltri_t) * lod->numtriangles);
+        }
+    }
+    header.filesize = offset;
+    if (model->flags & MODEL_SPHERE) {
+        header.flags = MODEL_SPHERE;
+        header.radius = (Uint16)model->radius;
+        header.numbands = (Uint8)model->numbands;
+        memcpy(header.bands, model->bands, sizeof(header.bands));
+    }
+    header.minx = (Sint16)model->bounds.minx;
+    header.miny = (Sint16)model->bounds.miny;
+    header.maxx = (Sint16)model->bounds.maxx;
+    header.maxy = (Sint16)model->bounds.maxy;
+    header.boundradius = (Uint16)model->bounds.radius;
+
+    file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Unable to create model file %s\n", path);
+        return 0;
+    }
+
+    ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fwrite(palette, sizeof(palette), 1, file) == 1 &&
+         fwrite(model->triangles, sizeof(modeltri_t) * model->numtriangles, 1, file) == 1;
+    if (ok && numcoarser > 0) {
+        ok = fwrite(&numcoarser, sizeof(numcoarser), 1, file) == 1 &&
+             fwrite(lods, sizeof(modelfile_lod_t) * numcoarser, 1, file) == 1;
+        for (i = 1; ok && i < model->numlods; i++) {
+            ok = fwrite(model->lods[i].triangles, sizeof(modeltri_t) * model->lods[i].numtriangles,
+                        1, file) == 1;
+        }
+    }
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Unable to write model file %s\n", path);
+    }
+
+    return ok;
+}
+
+/* Free the model and its arrays, or unmap the file they live in. */
+void model_destroy(model_t *model)
+{
+    int i;
+
+    if (!model) {
+        return;
+    }
+
+    if (model->mapping) {
+        munmap(model->mapping, model->mappingsize);
+    } else {
+        /* Level 0 is the full mesh itself */
+        for (i = 1; i < model->numlods; i++) {
+            free(model->lods[i].triangles);
+        }
+        free(model->triangles);
+        free(model->palette);
+    }
+    free(model);
+}
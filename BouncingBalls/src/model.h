@@ -0,0 +1,174 @@
+#ifndef MODEL_H_
+#define MODEL_H_
+
+#include "triangle.h"
+
+/*
+ * Model interface
+ *
+ * A model is an immutable, packed triangle mesh shared by every object
+ * drawn with it. Objects keep only their own transform; per-draw results
+ * go to a transient screentri_t buffer instead of back into the model.
+ * Triangles store 16-bit corners and an 8-bit index into a palette of at
+ * most MODEL_MAXCOLORS colors.
+ *
+ * Besides the full mesh a model may carry up to MODEL_MAXLODS - 1 coarser
+ * levels of detail, made offline by model_buildlods. Level 0 is always
+ * the full mesh. Each level records its error: how far, in model units,
+ * its outline strays from the outline of the full mesh. Detail inside the
+ * outline is not counted, as it is what small balls can spare. Drawn at
+ * scale s, a level's outline is off by about error * s pixels, so the
+ * renderer can pick the coarsest level whose error stays below a pixel
+ * threshold as the projected radius shrinks.
+ *
+ * A model flagged MODEL_SPHERE may instead be drawn as a disc impostor:
+ * a filled circle of the given radius, made of up to MODEL_MAXBANDS
+ * concentric rings colored from the palette.
+ */
+
+#define MODEL_MAXCOLORS     256
+#define MODEL_MAXLODS       5
+#define MODEL_MAXBANDS      8
+
+/* Model flags */
+#define MODEL_LOADING       0x1     /* Still being loaded in the background */
+#define MODEL_FAILED        0x2     /* Background load failed; nothing to draw */
+#define MODEL_SPHERE        0x4     /* Round enough to be drawn as a disc impostor; stored in files */
+
+/* Model file format identification */
+#define MODEL_FILEMAGIC     "BBMD"
+#define MODEL_FILEVERSION   4
+
+typedef struct modellod modellod_t;
+
+/* One level of detail of a model */
+struct modellod {
+    int         numtriangles;
+    modeltri_t  *triangles;
+    int         error;          /* Outline error in model units; 0 for the full mesh */
+};
+
+typedef struct modelbounds modelbounds_t;
+
+/* Box and circle around the corners of every level of detail, in model units */
+struct modelbounds {
+    int         minx, miny;
+    int         maxx, maxy;
+    int         radius;         /* Distance of the farthest corner from the origin, rounded up */
+};
+
+typedef struct model model_t;
+
+struct model {
+    int         numtriangles;   /* Number of triangles in the mesh */
+    modeltri_t  *triangles;     /* Packed triangle array */
+    int         numcolors;      /* Number of palette entries in use */
+    Uint32      *palette;       /* Fill colors that triangles index into */
+    unsigned int flags;         /* MODEL_* flags */
+
+    int         numlods;        /* Levels of detail, at least 1 once loaded */
+    modellod_t  lods[MODEL_MAXLODS];    /* Finest first; lods[0] is the full mesh above */
+    modelbounds_t bounds;       /* Set whenever the mesh or its levels change */
+
+    int         radius;         /* Impostor disc radius in model units, if MODEL_SPHERE */
+    int         numbands;       /* Impostor rings */
+    Uint8       bands[MODEL_MAXBANDS];  /* Palette indices of the rings, outermost first */
+
+    void        *mapping;       /* File mapping the arrays point into, or NULL */
+    size_t      mappingsize;    /* Length of the mapping in bytes */
+};
+
+typedef struct modelfile_header modelfile_header_t;
+
+/*
+ * Header at the start of a binary model file. All fields are in native
+ * (little-endian) byte order. The file holds a full MODEL_MAXCOLORS entry
+ * palette, so any stored color index is safe to look up without checking.
+ */
+struct modelfile_header {
+    char    magic[4];           /* MODEL_FILEMAGIC */
+    Uint16  version;            /* MODEL_FILEVERSION */
+    Uint16  headersize;         /* sizeof(modelfile_header_t) */
+    Uint32  numtriangles;       /* Number of modeltri_t records */
+    Uint32  numcolors;          /* Palette entries in use */
+    Uint32  paletteoffset;      /* File offset of the palette */
+    Uint32  triangleoffset;     /* File offset of the triangle array */
+    Uint32  filesize;           /* Total file size in bytes */
+    Uint32  lodoffset;          /* File offset of the LOD table, or 0; always 0 in version 1 */
+
+    /* Version 3 and later; older headers end here */
+    Uint32  flags;              /* MODEL_SPHERE or 0 */
+    Uint16  radius;             /* Impostor disc radius in model units */
+    Uint8   numbands;           /* Impostor rings, 1 to MODEL_MAXBANDS if MODEL_SPHERE */
+    Uint8   pad;                /* Must be 0 */
+    Uint8   bands[MODEL_MAXBANDS];  /* Palette indices of the rings, outermost first */
+
+    /* Version 4 and later; older files get bounds covering all of model space */
+    Sint16  minx, miny;         /* Bounds of every level's corners, see modelbounds_t */
+    Sint16  maxx, maxy;
+    Uint16  boundradius;        /* Bounding circle radius about the origin */
+    Uint16  pad2;               /* Must be 0 */
+};
+
+typedef struct modelfile_lod modelfile_lod_t;
+
+/*
+ * Entry of the LOD table, which is a Uint32 count of coarser levels
+ * followed by one entry per level, finest first. The full mesh described
+ * by the header is level 0 and has no entry.
+ */
+struct modelfile_lod {
+    Uint32  numtriangles;       /* Number of modeltri_t records */
+    Uint32  triangleoffset;     /* File offset of the triangle array */
+    Uint32  error;              /* Outline error in model units */
+    Uint32  reserved;           /* Must be 0 */
+};
+
+/*
+ * Return a newly created model packed from an array of triangle_t, such as
+ * the ones in the generated model headers. Meshes with more distinct colors
+ * than fit in the palette are color-quantized. Returns NULL if a coordinate
+ * does not fit in 16 bits or memory runs out.
+ */
+model_t *model_create(const triangle_t *triangles, int numtriangles);
+
+/*
+ * Add coarser levels of detail to a model made by model_create by vertex
+ * clustering: corners are snapped to a grid, each grid cell collapses to
+ * its corner farthest from the origin so round outlines keep their size,
+ * and triangles that become degenerate or duplicate are dropped. The cell
+ * size doubles from level to level, starting at 1/32 of the model radius,
+ * until a level would have fewer than 8 triangles; levels that drop less
+ * than a tenth of the previous level's triangles are skipped. Returns 1
+ * on success, 0 if memory runs out or the model is a file view.
+ */
+int model_buildlods(model_t *model);
+
+/*
+ * Flag a model made by model_create as a sphere impostor whose disc has
+ * numbands rings colored by the given palette indices, outermost first.
+ * The disc radius is the distance of the farthest corner from the
+ * origin. Returns 1 on success, 0 if the bands are invalid.
+ */
+int model_setimpostor(model_t *model, const Uint8 *bands, int numbands);
+
+/*
+ * Return a model that is a read-only view of a binary model file mapped
+ * into memory. Nothing is parsed or copied; pages are faulted in as the
+ * renderer first touches them. The bounds come from the header. Returns
+ * NULL if the file cannot be mapped or its header is invalid.
+ */
+model_t *model_load(const char *path);
+
+/*
+ * Write the model to path as a binary model file. Return 1 on success, 0 on failure.
+ */
+int model_save(const model_t *model, const char *path);
+
+/*
+ * Free the model, or unmap it if it was loaded from a file.
+ * No object may use it afterwards.
+ */
+void model_destroy(model_t *model);
+
+#endif /*MODEL_H_*/
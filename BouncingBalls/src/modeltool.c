@@ -0,0 +1,110 @@
+/*
+ * Model tool: converts built-in and imported meshes into binary model files.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "triangle.h"
+#include "model.h"
+#include "import.h"
+#include "teapot_data.h"
+#include "sphere_data.h"
+
+/*
+ * Print usage information to stderr.
+ */
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s export <dir>               Write the built-in sphere and teapot models to <dir>\n"
+            "       %s import <mesh> <out.bbm>    Convert an OBJ or binary STL mesh to a model file\n",
+            prog, prog);
+}
+
+/*
+ * Add levels of detail to the model, save it to path and report what was written.
+ */
+static int save_model(model_t *model, const char *path)
+{
+    int i;
+
+    if (!model_buildlods(model)) {
+        fprintf(stderr, "Failed to build levels of detail for %s\n", path);
+        return 0;
+    }
+    if (!model_save(model, path)) {
+        return 0;
+    }
+
+    printf("Wrote %s: %d triangles, %d colors; levels of detail", path, model->numtriangles, model->numcolors);
+    for (i = 1; i < model->numlods; i++) {
+        printf(" %d (error %d)", model->lods[i].numtriangles, model->lods[i].error);
+    }
+    printf("%s", model->numlods > 1 ? "" : " none");
+    if (model->flags & MODEL_SPHERE) {
+        printf("; disc impostor of radius %d with %d rings", model->radius, model->numbands);
+    }
+    printf("\n");
+
+    return 1;
+}
+
+/* Rings of the sphere's disc impostor, as palette indices from the outside in */
+static const Uint8 sphere_bands[] = { 1, 0, 1, 0 };
+
+/*
+ * Pack a built-in triangle array and save it as dir/name.bbm, flagged as a
+ * sphere impostor with the given rings unless bands is NULL.
+ */
+static int export_model(const char *dir, const char *name, triangle_t *triangles, int numtriangles,
+                        const Uint8 *bands, int numbands)
+{
+    char path[1024];
+    model_t *model;
+    int ok;
+
+    snprintf(path, sizeof(path), "%s/%s.bbm", dir, name);
+
+    model = model_create(triangles, numtriangles);
+    if (!model) {
+        fprintf(stderr, "Failed to pack model %s\n", name);
+        return 0;
+    }
+    if (bands && !model_setimpostor(model, bands, numbands)) {
+        fprintf(stderr, "Failed to make model %s an impostor\n", name);
+        model_destroy(model);
+        return 0;
+    }
+
+    ok = save_model(model, path);
+    model_destroy(model);
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "export") == 0) {
+        if (!export_model(argv[2], "sphere", sphere_model, SPHERE_NUMTRIANGLES,
+                          sphere_bands, (int)sizeof(sphere_bands)) ||
+            !export_model(argv[2], "teapot", teapot_model, TEAPOT_NUMTRIANGLES, NULL, 0)) {
+            return EXIT_FAILURE;
+        }
+        return 0;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "import") == 0) {
+        model_t *model = import_model(argv[2]);
+        int ok;
+
+        if (!model) {
+            return EXIT_FAILURE;
+        }
+        ok = save_model(model, argv[3]);
+        model_destroy(model);
+        return ok ? 0 : EXIT_FAILURE;
+    }
+
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
@@ -4,80 +4,399 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include <SDL2/SDL.h>
 #include "drawline.h"
+#include "disc.h"
 #include "triangle.h"
 #include "object.h"
+#include "profile.h"
 
+/* Half-size of the placeholder square, in model units, drawn while a model loads */
+#define PLACEHOLDER_RADIUS  500
+#define PLACEHOLDER_COLOR   0x00404040
+
+/* Where an object lands on its surface */
+#define PLACE_OUTSIDE       0   /* Wholly off the surface */
+#define PLACE_INSIDE        1   /* Wholly on the surface */
+#define PLACE_STRADDLING    2   /* Across a surface edge */
+
+/* Owning store of all live objects, created on first use. */
+static slotmap_t *objects = NULL;
+
+/* Recycled objects waiting for the next spawn. */
+static object_t *freeobjects = NULL;
+static objectpool_stats_t poolstats;
+
+/* Return a pooled object, allocating only if the pool is dry. */
+static object_t *object_alloc(void)
+{
+    object_t *object = freeobjects;
+
+    if (object) {
+        freeobjects = object->nextfree;
+        poolstats.numfree--;
+        poolstats.reused++;
+    } else {
+        object = malloc(sizeof(*object));
+        if (!object) {
+            return NULL;
+        }
+        poolstats.capacity++;
+        poolstats.heapallocs++;
+    }
+
+    poolstats.inuse++;
+    if (poolstats.inuse > poolstats.highwater) {
+        poolstats.highwater = poolstats.inuse;
+    }
+
+    return object;
+}
+
+/* Return an object to the pool. */
+static void object_release(object_t *object)
+{
+    object->nextfree = freeobjects;
+    freeobjects = object;
+    poolstats.numfree++;
+    poolstats.inuse--;
+}
+
+/* Pre-allocate pooled objects so spawning them later does not hit the heap. */
+int object_reservepool(int numobjects)
+{
+    object_t *object;
+
+    while (poolstats.numfree < numobjects) {
+        object = malloc(sizeof(*object));
+        if (!object) {
+            return 0;
+        }
+        poolstats.capacity++;
+        poolstats.heapallocs++;
+
+        /* Count it as in use for a moment so release keeps the books straight. */
+        poolstats.inuse++;
+        object_release(object);
+    }
+
+    return 1;
+}
+
+/* Copy the current object pool statistics. */
+void object_getpoolstats(objectpool_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    *stats = poolstats;
+}
 
 /* Return a newly created object with default transform and velocity. */
-object_t *create_object(SDL_Surface *surface, triangle_t *model, int numtriangles)
+object_t *create_object(SDL_Surface *surface, const model_t *model)
 {
     object_t *object;
 
-    if (!surface || !model || numtriangles <= 0) {
+    /* A model still loading has no triangles yet, but objects may already use it. */
+    if (!surface || !model || (model->numtriangles <= 0 && !(model->flags & MODEL_LOADING))) {
         return NULL;
     }
 
-    object = malloc(sizeof(*object));
-    if (!object) {
-        return NULL;
+    if (!objects) {
+        objects = slotmap_create();
+        if (!objects) {
+            return NULL;
+        }
     }
 
-    object->model = malloc(sizeof(triangle_t) * numtriangles);
-    if (!object->model) {
-        free(object);
+    object = object_alloc();
+    if (!object) {
         return NULL;
     }
 
-    /* Deep-copy the mesh so every instance can evolve independently. */
-    memcpy(object->model, model, sizeof(triangle_t) * numtriangles);
-
+    /* Instances share the immutable model; only the transform is per object. */
+    object->model = model;
     object->surface = surface;
-    object->numtriangles = numtriangles;
 
     object->scale = 1.0f;
     object->rotation = 0.0f;
     object->rotation_way = 0;
+    object->spin = 0.0f;
     object->tx = 0.0f;
     object->ty = 0.0f;
     object->speedx = 0.0f;
     object->speedy = 0.0f;
+    object->resting = 0;
+    object->lod = 0;
     /* Default TTL; used as an absolute expiration timestamp in ms once set. */
     object->ttl = 0;
+    wheeltimer_init(&object->expiry);
+    object->link.next = NULL;
+    object->link.prev = NULL;
+    object->nextfree = NULL;
+
+    object->handle = slotmap_insert(objects, object);
+    if (object->handle == SLOTMAP_NULL) {
+        object_release(object);
+        return NULL;
+    }
 
     return object;
 }
 
-/* Destroy the object, freeing its model data and itself. */
+/* Destroy the object, handing it back to the pool. */
 void destroy_object(object_t *object)
 {
     if (!object) {
         return;
     }
 
-    free(object->model);
-    free(object);
+    timerwheel_cancel(&object->expiry);
+    slotmap_erase(objects, object->handle);
+    object->handle = SLOTMAP_NULL;
+    object_release(object);
 }
 
-/* Draw the object on its surface using its triangle model. */
-void draw_object(object_t *object)
+/* Return the live object named by handle, or NULL if it is stale. */
+object_t *object_lookup(slothandle_t handle)
 {
+    return slotmap_get(objects, handle);
+}
+
+/* Return the number of live objects. */
+int object_count(void)
+{
+    return slotmap_size(objects);
+}
+
+/* Return the live object at the given dense position. */
+object_t *object_at(int index)
+{
+    return slotmap_at(objects, index);
+}
+
+/* Destroy every live object, last first so no item has to move, then free the store and pool. */
+void destroy_all_objects(void)
+{
+    object_t *object;
     int i;
 
+    for (i = slotmap_size(objects) - 1; i >= 0; i--) {
+        destroy_object(slotmap_at(objects, i));
+    }
+
+    slotmap_destroy(objects);
+    objects = NULL;
+
+    while (freeobjects) {
+        object = freeobjects;
+        freeobjects = object->nextfree;
+        free(object);
+    }
+    poolstats.capacity = 0;
+    poolstats.numfree = 0;
+}
+
+/*
+ * Return the level of detail to draw the object with: the coarsest level
+ * whose error, scaled to pixels, is within the context's threshold. A
+ * level only changes once its error clears the threshold by the
+ * hysteresis margin, so objects near a threshold do not flicker.
+ */
+static int select_lod(object_t *object, const drawcontext_t *context)
+{
+    const model_t *model = object->model;
+    float scale = fabsf(object->scale);
+    float coarser = context->lodpixels * (1.0f - context->lodhysteresis);
+    float finer = context->lodpixels * (1.0f + context->lodhysteresis);
+    int level = object->lod;
+
+    if (context->lodpixels <= 0.0f || model->numlods <= 1) {
+        return 0;
+    }
+    if (level >= model->numlods) {
+        level = model->numlods - 1;
+    }
+
+    while (level + 1 < model->numlods && model->lods[level + 1].error * scale <= coarser) {
+        level++;
+    }
+    while (level > 0 && model->lods[level].error * scale > finer) {
+        level--;
+    }
+
+    object->lod = level;
+    return level;
+}
+
+/*
+ * Return where the object lands on its surface, judged from the model's
+ * bounds alone. transform_triangle truncates scaled and rotated corners
+ * towards zero, so they stay within the transformed bounds rounded
+ * outwards; a pixel of padding absorbs float error in the rotation.
+ */
+static int place_object(const object_t *object, const transform_t *transform)
+{
+    const modelbounds_t *bounds = &object->model->bounds;
+    SDL_Surface *surface = object->surface;
+    float scale = object->scale;
+    float radius = ceilf(bounds->radius * fabsf(scale));
+    float x0 = floorf(fminf(bounds->minx * scale, bounds->maxx * scale));
+    float x1 = ceilf(fmaxf(bounds->minx * scale, bounds->maxx * scale));
+    float y0 = floorf(fminf(bounds->miny * scale, bounds->maxy * scale));
+    float y1 = ceilf(fmaxf(bounds->miny * scale, bounds->maxy * scale));
+    int left, right, top, bottom;
+
+    if (transform->matrix[0][1] != 0.0f || transform->matrix[0][0] != 1.0f) {
+        /* Rotate the box and keep whichever of it and the bounding circle is tighter */
+        const float (*m)[2] = transform->matrix;
+        float cx[4] = { x0, x1, x0, x1 }, cy[4] = { y0, y0, y1, y1 };
+        float rx, ry;
+        int i;
+
+        x0 = y0 = radius;
+        x1 = y1 = -radius;
+        for (i = 0; i < 4; i++) {
+            rx = cx[i] * m[0][0] + cy[i] * m[0][1];
+            ry = cx[i] * m[1][0] + cy[i] * m[1][1];
+            x0 = fminf(x0, rx);
+            x1 = fmaxf(x1, rx);
+            y0 = fminf(y0, ry);
+            y1 = fmaxf(y1, ry);
+        }
+        x0 = fmaxf(x0, -radius);
+        x1 = fminf(x1, radius);
+        y0 = fmaxf(y0, -radius);
+        y1 = fminf(y1, radius);
+    }
+
+    left = transform->tx + (int)floorf(x0) - 1;
+    right = transform->tx + (int)ceilf(x1) + 1;
+    top = transform->ty + (int)floorf(y0) - 1;
+    bottom = transform->ty + (int)ceilf(y1) + 1;
+
+    if (right < 0 || left >= surface->w || bottom < 0 || top >= surface->h) {
+        return PLACE_OUTSIDE;
+    }
+    if (left >= 0 && right < surface->w && top >= 0 && bottom < surface->h) {
+        return PLACE_INSIDE;
+    }
+    return PLACE_STRADDLING;
+}
+
+/*
+ * Draw the object as a disc if its model is a sphere impostor small enough
+ * on screen. Return 1 if it was drawn, 0 if it needs its triangles.
+ */
+static int draw_impostor(object_t *object, const drawcontext_t *context)
+{
+    const model_t *model = object->model;
+    Uint32 colors[MODEL_MAXBANDS];
+    int radius, i;
+
+    if (!(model->flags & MODEL_SPHERE) || context->impostorpixels <= 0) {
+        return 0;
+    }
+    radius = (int)lroundf(model->radius * fabsf(object->scale));
+    if (radius > context->impostorpixels) {
+        return 0;
+    }
+
+    for (i = 0; i < model->numbands; i++) {
+        colors[i] = model->palette[model->bands[i]];
+    }
+    /* A wireframe keeps only the rings' outlines, like the triangles' */
+    if (context->rasterizer == TRIANGLE_WIREFRAME) {
+        if (!draw_discoutline(object->surface, (int)object->tx, (int)object->ty, radius,
+                              colors, model->numbands, context->stats)) {
+            return 0;
+        }
+    } else if (!draw_disc(object->surface, (int)object->tx, (int)object->ty, radius,
+                          colors, model->numbands, context->stats)) {
+        return 0;
+    }
+    if (context->stats) {
+        context->stats->objects++;
+    }
+
+    return 1;
+}
+
+/* Draw the object on its surface by transforming its model into screen space. */
+void draw_object(object_t *object, const drawcontext_t *context)
+{
+    void (*draw)(SDL_Surface *, screentri_t *, renderstats_t *);
+    const model_t *model;
+    const modeltri_t *triangles;
+    transform_t transform;
+    screentri_t tri;
+    int numtriangles;
+    int i, level, place;
+
     if (!object) {
         return;
     }
 
-    for (i = 0; i < object->numtriangles; i++) {
-        triangle_t tri = object->model[i];
+    model = object->model;
+    if (model->flags & MODEL_FAILED) {
+        return;
+    }
+    if (model->flags & MODEL_LOADING) {
+        /* Stand-in until the real model arrives */
+        int r = (int)(PLACEHOLDER_RADIUS * object->scale);
+        SDL_Rect rect = { (int)object->tx - r, (int)object->ty - r, 2 * r, 2 * r };
 
-        /* Apply the current transform to a local copy of the mesh. */
-        tri.scale = object->scale;
-        tri.rotation = object->rotation;
-        tri.tx = (int)object->tx;
-        tri.ty = (int)object->ty;
+        SDL_FillRect(object->surface, &rect, PLACEHOLDER_COLOR);
+        return;
+    }
+
+    /* One rotation matrix per object and frame; the triangles only multiply */
+    transform.scale = object->scale;
+    transform_setrotation(&transform, object->rotation);
+    transform.tx = (int)object->tx;
+    transform.ty = (int)object->ty;
+    transform.palette = model->palette;
 
-        draw_triangle(object->surface, &tri);
+    /* Skip objects off the surface; only those across its edges need clipping */
+    place = place_object(object, &transform);
+    if (place == PLACE_OUTSIDE) {
+        if (context->stats) {
+            context->stats->offscreen++;
+        }
+        return;
     }
-} 
+    /* Triangles of an object wholly on the surface need no bounds check */
+    draw = context->rasterizer == TRIANGLE_WIREFRAME ? wire_screentriangle : fill_screentriangle;
+
+    if (draw_impostor(object, context)) {
+        return;
+    }
+
+    level = select_lod(object, context);
+    if (level > 0) {
+        triangles = model->lods[level].triangles;
+        numtriangles = model->lods[level].numtriangles;
+    } else {
+        triangles = model->triangles;
+        numtriangles = model->numtriangles;
+    }
+
+    if (context->stats) {
+        context->stats->objects++;
+        context->stats->submitted += numtriangles;
+    }
+
+    /* Draw each triangle as soon as it is transformed, while it is still in cache */
+    for (i = 0; i < numtriangles; i++) {
+        PROFILE_BEGIN(start);
+        transform_triangle(&triangles[i], &transform, &tri);
+        PROFILE_END(PROFILE_TRANSFORM, start);
+        if (place == PLACE_INSIDE) {
+            draw(object->surface, &tri, context->stats);
+        } else {
+            draw_clippedtriangle(object->surface, &tri, context->rasterizer, context->stats);
+        }
+    }
+}
@@ -2,39 +2,116 @@
 #define OBJECT_H_
 
 #include "triangle.h"
+#include "model.h"
+#include "ilist.h"
+#include "slotmap.h"
+#include "timerwheel.h"
+#include "arena.h"
 #include <SDL2/SDL.h>
 
 typedef struct object object_t;
 
 struct object {
     float       scale;          /* Object scale */
-    float       rotation;       /* Object rotation */
-    int         rotation_way;   /* The way the object rotates */
+    float       rotation;       /* Object rotation in degrees, 0 to 360 */
+    int         rotation_way;   /* The way the object rotates: 1, -1, or 0 for not at all */
+    float       spin;           /* Degrees turned per frame in rotation_way */
     float       tx, ty;         /* Position on screen */
     
     float       speedx, speedy; /* Object speed in x and y direction */
+    int         resting;        /* Set by the physics step while settled on the ground */
+    int         lod;            /* Level of detail drawn last, kept for hysteresis */
     unsigned int ttl;           /* Time till object should be removed from screen */
+    wheeltimer_t expiry;        /* Timer firing at ttl while one is set */
     
-    int         numtriangles;   /* Number of triangles in model */
-    triangle_t  *model;         /* Model triangle array */
+    const model_t *model;       /* Shared, immutable triangle mesh */
 
     SDL_Surface *surface;       /* SDL screen */
+
+    ilink_t     link;           /* Link in the list of live objects */
+    slothandle_t handle;        /* Handle naming the object in the object store */
+    object_t    *nextfree;      /* Next recycled object while in the object pool */
+};
+
+typedef struct drawcontext drawcontext_t;
+
+/*
+ * Per-frame rendering state shared by every draw_object call.
+ */
+struct drawcontext {
+    arena_t     *frame;         /* Scratch memory reset every frame, or NULL */
+    int         rasterizer;     /* TRIANGLE_FILLED or TRIANGLE_WIREFRAME */
+    renderstats_t *stats;       /* Counters for the frame, or NULL */
+    float       lodpixels;      /* Error in pixels a level of detail may have; 0 draws full detail */
+    float       lodhysteresis;  /* Fraction of lodpixels a level's error must clear to switch */
+    int         impostorpixels; /* Largest radius in pixels drawn as a disc for MODEL_SPHERE models; 0 never */
+};
+
+typedef struct objectpool_stats objectpool_stats_t;
+
+struct objectpool_stats {
+    int  capacity;      /* Objects allocated from the heap and not yet freed */
+    int  inuse;         /* Objects currently live */
+    int  numfree;       /* Objects waiting in the pool for reuse */
+    int  highwater;     /* Highest number of live objects at once */
+    long reused;        /* Spawns served from the pool */
+    long heapallocs;    /* Heap allocations of objects */
 };
 
 
 /*
  * Return a newly created object based on the arguments provided.
+ * The object is owned by the object store until destroy_object is called.
+ * The model may still be loading in the background (MODEL_LOADING).
  */
-object_t *create_object(SDL_Surface *surface, triangle_t *triangles, int numtriangles);
+object_t *create_object(SDL_Surface *surface, const model_t *model);
 
 /*
- * Destroy the object, freeing the memory.
+ * Destroy the object, returning it to the object pool.
  */
 void destroy_object(object_t *object);
 
 /*
- * Draw the object on its surface.
+ * Pre-allocate numobjects pooled objects, so spawning that many objects
+ * later causes no heap traffic. Return 1 on success, 0 if memory ran out.
+ */
+int object_reservepool(int numobjects);
+
+/*
+ * Copy the current object pool statistics into stats.
+ */
+void object_getpoolstats(objectpool_stats_t *stats);
+
+/*
+ * Return the live object named by handle, or NULL if it has been destroyed.
+ */
+object_t *object_lookup(slothandle_t handle);
+
+/*
+ * Return the number of live objects in the object store.
+ */
+int object_count(void);
+
+/*
+ * Return the live object at dense position index, 0 <= index < object_count().
+ */
+object_t *object_at(int index);
+
+/*
+ * Destroy every live object and free the object store and object pool.
+ */
+void destroy_all_objects(void);
+
+/*
+ * Draw the object on its surface with the context's rasterizer. Each
+ * triangle is drawn as soon as it is transformed, so no screen-space
+ * buffer is kept. The model's bounds are checked against the surface
+ * first: an object wholly off the surface is skipped, and only one across
+ * a surface edge is drawn clipped. A MODEL_SPHERE model no larger on
+ * screen than the context's impostorpixels is drawn as a banded disc
+ * instead. A model that is still loading is drawn as a plain square; a
+ * failed one not at all.
  */
-void draw_object(object_t *object);
+void draw_object(object_t *object, const drawcontext_t *context);
 
 #endif /*OBJECT_H_*/
@@ -0,0 +1,88 @@
+/*
+ * Physics module: moving balls and bouncing them off the walls.
+ */
+#include <stdlib.h>
+#include <math.h>
+#include "physics.h"
+
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
+/* Advance the ball by one frame. */
+void physics_step(object_t *ball, const physics_t *physics)
+{
+    int r = (int)((PHYSICS_BALLRADIUS * ball->scale) + 10.0f);
+
+    /* Update physics */
+    ball->speedy += physics->gravity;
+    ball->speedx *= physics->air;
+    ball->speedy *= physics->air;
+    ball->tx += ball->speedx;
+    ball->ty += ball->speedy;
+
+    /* Spin, keeping the rotation within [0, 360) */
+    if (ball->rotation_way != 0 && ball->spin != 0.0f) {
+        ball->spin *= physics->air;
+        ball->rotation += ball->rotation_way * ball->spin;
+        if (ball->rotation < 0.0f) {
+            ball->rotation += 360.0f;
+        } else if (ball->rotation >= 360.0f) {
+            ball->rotation -= 360.0f;
+        }
+    }
+
+    /* Handle collisions with walls */
+    if (ball->tx - r < 0) {
+        ball->tx = r;
+        ball->speedx = -ball->speedx * physics->bounce;
+    }
+    if (ball->tx + r > physics->width) {
+        ball->tx = physics->width - r;
+        ball->speedx = -ball->speedx * physics->bounce;
+    }
+    if (ball->ty - r < 0) {
+        ball->ty = r;
+        ball->speedy = -ball->speedy * physics->bounce;
+    }
+    if (ball->ty + r > physics->height) {
+        ball->ty = physics->height - r;
+        ball->speedy = -ball->speedy * physics->bounce;
+    }
+
+    /* If the ball is resting on the ground, stop its motion */
+    int ground = (ball->ty + r >= physics->height - 1);
+    ball->resting = ground &&
+                    fabsf(ball->speedx) < physics->restspeed &&
+                    fabsf(ball->speedy) < physics->restspeed;
+    if (ball->resting) {
+        ball->speedx = 0.0f;
+        ball->speedy = 0.0f;
+        ball->spin = 0.0f;
+        ball->ty = physics->height - r;
+    }
+}
+
+/* Step a slice of the live objects; run by the worker pool. */
+void physics_stepslice(void *arg, int begin, int end, int worker)
+{
+    const physics_t *physics = arg;
+
+    (void)worker;
+    for (int i = begin; i < end; i++) {
+        physics_step(object_at(i), physics);
+    }
+}
+
+/* Give each ball random size, position, speed and spin. */
+void physics_launch(object_t *ball, int width, int height)
+{
+    int usable_w = MAX(1, width - 200);
+    int usable_h = MAX(1, height / 3);
+
+    ball->scale  = 0.15f + ((float)rand() / (float)RAND_MAX) * 0.15f;
+    ball->tx     = (float)(rand() % usable_w) + 100.0f;
+    ball->ty     = (float)(rand() % usable_h) + 50.0f;
+    ball->speedx = ((float)rand() / (float)RAND_MAX) * 100.0f - 50.0f;
+    ball->speedy = ((float)rand() / (float)RAND_MAX) * 80.0f  - 60.0f;
+    ball->spin   = ((float)rand() / (float)RAND_MAX) * PHYSICS_MAXSPIN;
+    ball->rotation_way = rand() % 2 ? 1 : -1;
+}
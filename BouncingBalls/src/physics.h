@@ -0,0 +1,48 @@
+#ifndef PHYSICS_H_
+#define PHYSICS_H_
+
+#include "object.h"
+
+/*
+ * Ball physics interface
+ *
+ * Balls fall under gravity, lose speed and spin to air drag, bounce off
+ * the walls of a width x height box and come to rest on its floor. A step only
+ * touches the ball it is given, so balls can be stepped in parallel.
+ */
+
+/* Radius of the ball models in model units; imported meshes are fitted to it as well */
+#define PHYSICS_BALLRADIUS  500.0f
+
+/* Fastest spin in degrees per frame a ball is launched with */
+#define PHYSICS_MAXSPIN     6.0f
+
+typedef struct physics physics_t;
+
+struct physics {
+    float   gravity;    /* Added to the vertical speed every frame */
+    float   air;        /* Speed kept per frame after drag */
+    float   bounce;     /* Speed kept when bouncing off a wall */
+    float   restspeed;  /* Speed below which a ball on the floor settles */
+    int     width;      /* Size of the box the balls bounce in */
+    int     height;
+};
+
+/*
+ * Advance the ball by one frame and set ball->resting if it has settled.
+ */
+void physics_step(object_t *ball, const physics_t *physics);
+
+/*
+ * Step the live objects [begin, end) by dense position; arg is the
+ * physics_t. Matches workers_fn_t, so the pool can split the step.
+ */
+void physics_stepslice(void *arg, int begin, int end, int worker);
+
+/*
+ * Give a new ball a random size, a position in the upper part of a
+ * width x height box, a random speed and a random spin, drawn from rand().
+ */
+void physics_launch(object_t *ball, int width, int height);
+
+#endif /*PHYSICS_H_*/
@@ -0,0 +1,192 @@
+/*
+ * Profile module: per-stage frame timings and their rolling statistics.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "profile.h"
+
+/* HUD layout in pixels; the bars span HUD_RANGE ms */
+#define HUD_X           8
+#define HUD_Y           8
+#define HUD_WIDTH       300
+#define HUD_BARHEIGHT   8
+#define HUD_SPACING     3
+#define HUD_RANGE       33.3
+#define HUD_BACKGROUND  0x00202020
+#define HUD_MARKCOLOR   0x00808080
+#define HUD_TICKCOLOR   0x00ffffff
+
+int profile_active = 0;
+
+static const char *stagenames[PROFILE_NUMSTAGES] = {
+    "clear", "physics", "transform", "lines", "fill", "present", "frame"
+};
+
+/* Bar colors, one per stage */
+static const Uint32 stagecolors[PROFILE_NUMSTAGES] = {
+    0x004060c0, 0x0040a040, 0x00c0c040, 0x00c08040, 0x00c04040, 0x008040c0, 0x00c0c0c0
+};
+
+static Uint64 current[PROFILE_NUMSTAGES];   /* Ticks so far in this frame */
+static Uint64 framestart;
+static float history[PROFILE_NUMSTAGES][PROFILE_HISTORY];  /* ms per frame */
+static int numframes;                       /* Frames recorded, up to PROFILE_HISTORY */
+static int nextframe;                       /* Ring position of the next frame */
+
+/* Enable or disable profiling. */
+void profile_enable(int enable)
+{
+    profile_active = enable;
+    memset(current, 0, sizeof(current));
+    numframes = 0;
+    nextframe = 0;
+}
+
+/* Add ticks to stage for the current frame. */
+void profile_add(int stage, Uint64 ticks)
+{
+    current[stage] += ticks;
+}
+
+/* Mark the start of a frame. */
+void profile_beginframe(void)
+{
+    if (!profile_active) {
+        return;
+    }
+
+    memset(current, 0, sizeof(current));
+    framestart = SDL_GetPerformanceCounter();
+}
+
+/* Mark the end of a frame and record its stage totals. */
+void profile_endframe(void)
+{
+    double tickms;
+    int i;
+
+    if (!profile_active) {
+        return;
+    }
+
+    current[PROFILE_FRAME] = SDL_GetPerformanceCounter() - framestart;
+
+    tickms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+    for (i = 0; i < PROFILE_NUMSTAGES; i++) {
+        history[i][nextframe] = (float)(current[i] * tickms);
+    }
+    nextframe = (nextframe + 1) % PROFILE_HISTORY;
+    if (numframes < PROFILE_HISTORY) {
+        numframes++;
+    }
+}
+
+/* qsort comparator for frame times. */
+static int compare_float(const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+
+    return (fa > fb) - (fa < fb);
+}
+
+/* Compute statistics for stage over the recorded frames. */
+void profile_getstats(int stage, profile_stats_t *stats)
+{
+    float sorted[PROFILE_HISTORY];
+    double sum = 0.0;
+    int i;
+
+    memset(stats, 0, sizeof(*stats));
+    if (numframes == 0) {
+        return;
+    }
+
+    /* The ring is filled from the start, so the first numframes entries are the recorded ones */
+    memcpy(sorted, history[stage], sizeof(float) * numframes);
+    qsort(sorted, numframes, sizeof(float), compare_float);
+    for (i = 0; i < numframes; i++) {
+        sum += sorted[i];
+    }
+
+    stats->numframes = numframes;
+    stats->min = sorted[0];
+    stats->avg = sum / numframes;
+    stats->p50 = sorted[(numframes - 1) / 2];
+    stats->p99 = sorted[(numframes - 1) * 99 / 100];
+}
+
+/* Return the name of stage. */
+const char *profile_stagename(int stage)
+{
+    return stagenames[stage];
+}
+
+/* Return the HUD bar length in pixels for ms. */
+static int bar_length(double ms)
+{
+    int length = (int)(ms * HUD_WIDTH / HUD_RANGE);
+
+    return length > HUD_WIDTH ? HUD_WIDTH : length;
+}
+
+/* Draw the statistics as a bar overlay. */
+void profile_drawhud(SDL_Surface *surface)
+{
+    profile_stats_t stats;
+    SDL_Rect rect;
+    int i, y;
+
+    if (!profile_active || numframes == 0) {
+        return;
+    }
+
+    rect.x = HUD_X - 4;
+    rect.y = HUD_Y - 4;
+    rect.w = HUD_WIDTH + 8;
+    rect.h = PROFILE_NUMSTAGES * (HUD_BARHEIGHT + HUD_SPACING) - HUD_SPACING + 8;
+    SDL_FillRect(surface, &rect, HUD_BACKGROUND);
+
+    /* The 60 Hz frame budget */
+    rect.x = HUD_X + bar_length(1000.0 / 60.0);
+    rect.y = HUD_Y;
+    rect.w = 1;
+    rect.h = PROFILE_NUMSTAGES * (HUD_BARHEIGHT + HUD_SPACING) - HUD_SPACING;
+    SDL_FillRect(surface, &rect, HUD_MARKCOLOR);
+
+    for (i = 0; i < PROFILE_NUMSTAGES; i++) {
+        profile_getstats(i, &stats);
+        y = HUD_Y + i * (HUD_BARHEIGHT + HUD_SPACING);
+
+        rect.x = HUD_X;
+        rect.y = y;
+        rect.w = bar_length(stats.avg);
+        rect.h = HUD_BARHEIGHT;
+        SDL_FillRect(surface, &rect, stagecolors[i]);
+
+        rect.x = HUD_X + bar_length(stats.p99);
+        rect.w = 1;
+        SDL_FillRect(surface, &rect, HUD_TICKCOLOR);
+    }
+}
+
+/* Print a table of the statistics for every stage. */
+void profile_dump(FILE *file)
+{
+    profile_stats_t stats;
+    int i;
+
+    if (numframes == 0) {
+        return;
+    }
+
+    fprintf(file, "Frame profile over the last %d frames (ms):\n", numframes);
+    fprintf(file, "%-10s %9s %9s %9s %9s\n", "stage", "min", "avg", "p50", "p99");
+    for (i = 0; i < PROFILE_NUMSTAGES; i++) {
+        profile_getstats(i, &stats);
+        fprintf(file, "%-10s %9.3f %9.3f %9.3f %9.3f\n",
+                stagenames[i], stats.min, stats.avg, stats.p50, stats.p99);
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+/*
+ * Frame profiler interface
+ *
+ * Scopes placed around the stages of a frame add their elapsed
+ * performance-counter time to the stage's total for the current frame.
+ * Each finished frame's totals go into a ring buffer of the last
+ * PROFILE_HISTORY frames, from which min/avg/p50/p99 are computed for the
+ * on-screen HUD and the summary dumped on exit.
+ *
+ * While profiling is disabled a scope costs one test of profile_active.
+ * Building with -DNO_PROFILE (make PROFILE=0) removes the scopes entirely.
+ * Scopes must only be used on the main thread.
+ */
+
+/* Frame stages */
+#define PROFILE_CLEAR       0   /* clear_screen */
+#define PROFILE_PHYSICS     1   /* Expiry and the physics step */
+#define PROFILE_TRANSFORM   2   /* Model to screen space */
+#define PROFILE_LINES       3   /* Triangle outlines */
+#define PROFILE_FILL        4   /* fill_triangle */
+#define PROFILE_PRESENT     5   /* Showing the finished frame */
+#define PROFILE_FRAME       6   /* The whole frame */
+#define PROFILE_NUMSTAGES   7
+
+/* Number of frames the statistics are computed over */
+#define PROFILE_HISTORY     256
+
+#ifndef NO_PROFILE
+/* Start timing a scope, storing the start time in a new variable var */
+#define PROFILE_BEGIN(var) \
+    Uint64 var = profile_active ? SDL_GetPerformanceCounter() : 0
+/* Add the time since PROFILE_BEGIN(var) to stage */
+#define PROFILE_END(stage, var) \
+    do { \
+        if (profile_active) \
+            profile_add(stage, SDL_GetPerformanceCounter() - var); \
+    } while (0)
+#else
+#define PROFILE_BEGIN(var)
+#define PROFILE_END(stage, var)
+#endif
+
+typedef struct profile_stats profile_stats_t;
+
+struct profile_stats {
+    int     numframes;  /* Frames the statistics cover */
+    double  min;        /* Times in ms */
+    double  avg;
+    double  p50;
+    double  p99;
+};
+
+/* Nonzero while profiling is enabled; tested by the scope macros */
+extern int profile_active;
+
+/*
+ * Enable or disable profiling. Enabling clears the history.
+ */
+void profile_enable(int enable);
+
+/*
+ * Add ticks performance-counter ticks to stage for the current frame.
+ */
+void profile_add(int stage, Uint64 ticks);
+
+/*
+ * Mark the start of a frame.
+ */
+void profile_beginframe(void);
+
+/*
+ * Mark the end of a frame and record its stage totals.
+ */
+void profile_endframe(void);
+
+/*
+ * Compute statistics for stage over the recorded frames.
+ */
+void profile_getstats(int stage, profile_stats_t *stats);
+
+/*
+ * Return the name of stage.
+ */
+const char *profile_stagename(int stage);
+
+/*
+ * Draw the statistics as a bar overlay in the top left corner of surface:
+ * one bar per stage, as long as its average time, with a tick at its p99.
+ * The scale runs from 0 to 33.3 ms, with a mark at 16.7 ms.
+ */
+void profile_drawhud(SDL_Surface *surface);
+
+/*
+ * Print a table of the statistics for every stage.
+ */
+void profile_dump(FILE *file);
+
+#endif /*PROFILE_H_*/
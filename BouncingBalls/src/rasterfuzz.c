@@ -0,0 +1,517 @@
+/*
+ * Differential fuzzing of the triangle pipeline against the reference
+ * rasterizer.
+ *
+ * Each case draws one randomly generated triangle on a surface of random
+ * noise twice: through the pipeline (fill_screentriangle or
+ * wire_screentriangle, after transform_triangle for model cases) and
+ * through refraster. The pipeline kernels draw unchecked, so they only get
+ * triangles with every corner on the surface. The triangle is then drawn
+ * twice more, clipped: through draw_clippedtriangle and
+ * refraster_drawclipped. Any pixel that differs is a mismatch; so is a
+ * transformed triangle whose corners or bounding box differ. A failing
+ * case is shrunk while it keeps failing and then printed, so the repro is
+ * as small as the generator allows.
+ *
+ * Case kinds: random, degenerate (points and collinear), sliver, huge
+ * (spanning the surface, on its edges), off-screen, and model triangles
+ * through random transforms including negative scales.
+ *
+ * Usage: rasterfuzz [--cases N] [--seed N] [--size WIDTHxHEIGHT] [--reports N]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <SDL2/SDL.h>
+#include "triangle.h"
+#include "refraster.h"
+
+#define FUZZ_CASES      20000
+#define FUZZ_WIDTH      64
+#define FUZZ_HEIGHT     48
+#define FUZZ_REPORTS    10      /* Mismatches printed before the rest are only counted */
+
+/* Case kinds */
+enum {
+    FUZZ_RANDOM,
+    FUZZ_DEGENERATE,
+    FUZZ_SLIVER,
+    FUZZ_HUGE,
+    FUZZ_OFFSCREEN,
+    FUZZ_MODEL,
+    FUZZ_NUMKINDS
+};
+
+static const char *kindnames[FUZZ_NUMKINDS] = {
+    "random", "degenerate", "sliver", "huge", "off-screen", "model"
+};
+
+typedef struct fuzzcase fuzzcase_t;
+
+struct fuzzcase {
+    int         kind;
+    int         rasterizer;
+    screentri_t screen;     /* The triangle drawn, unless kind is FUZZ_MODEL */
+    modeltri_t  model;      /* The model triangle, if kind is FUZZ_MODEL */
+    float       scale;      /* Its transform */
+    float       rotation;
+    int         tx, ty;
+    Uint32      color;
+    unsigned int noise;     /* Seed of the background */
+};
+
+typedef struct mismatch mismatch_t;
+
+struct mismatch {
+    int     transform;      /* The transformed triangles differ */
+    int     clipped;        /* The pixels differ when drawn clipped */
+    screentri_t gottri, expectedtri;   /* The transformed triangles, if they differ */
+    long    pixels;         /* Pixels that differ */
+    int     x, y;           /* The first of them */
+    Uint32  got, expected;
+};
+
+/* Where results go; stdout is silenced while fuzzing */
+static FILE *report;
+
+static SDL_Surface *actual, *expected;
+
+/* Return the next number from a xorshift generator. */
+static unsigned int next_random(unsigned int *state)
+{
+    unsigned int x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+/* Return a random integer in [lo, hi]. */
+static int random_int(unsigned int *state, int lo, int hi)
+{
+    return lo + (int)(next_random(state) % (unsigned int)(hi - lo + 1));
+}
+
+/* Return a random opaque color; the pipeline's pen color is never opaque. */
+static Uint32 random_color(unsigned int *state)
+{
+    return 0xFF000000 | (next_random(state) & 0x00FFFFFF);
+}
+
+/* Set the corners of a screen-space triangle. */
+static void set_corners(screentri_t *tri, int x1, int y1, int x2, int y2, int x3, int y3)
+{
+    tri->sx1 = x1;
+    tri->sy1 = y1;
+    tri->sx2 = x2;
+    tri->sy2 = y2;
+    tri->sx3 = x3;
+    tri->sy3 = y3;
+}
+
+/* Set the bounding box of a screen-space triangle from its corners. */
+static void set_bounds(screentri_t *tri)
+{
+    int minx = tri->sx1, maxx = tri->sx1, miny = tri->sy1, maxy = tri->sy1;
+
+    minx = tri->sx2 < minx ? tri->sx2 : minx;
+    minx = tri->sx3 < minx ? tri->sx3 : minx;
+    maxx = tri->sx2 > maxx ? tri->sx2 : maxx;
+    maxx = tri->sx3 > maxx ? tri->sx3 : maxx;
+    miny = tri->sy2 < miny ? tri->sy2 : miny;
+    miny = tri->sy3 < miny ? tri->sy3 : miny;
+    maxy = tri->sy2 > maxy ? tri->sy2 : maxy;
+    maxy = tri->sy3 > maxy ? tri->sy3 : maxy;
+
+    tri->rect.x = minx;
+    tri->rect.y = miny;
+    tri->rect.w = maxx - minx + 1;
+    tri->rect.h = maxy - miny + 1;
+}
+
+/* Generate a random case for a surface of w by h pixels. */
+static void generate_case(fuzzcase_t *c, unsigned int *state, int w, int h)
+{
+    int x1, y1, x2, y2, x3, y3;
+
+    memset(c, 0, sizeof(*c));
+    c->kind = random_int(state, 0, FUZZ_NUMKINDS - 1);
+    c->rasterizer = random_int(state, 0, 1) ? TRIANGLE_WIREFRAME : TRIANGLE_FILLED;
+    c->color = random_color(state);
+    c->noise = next_random(state) | 1;
+
+    x1 = random_int(state, 0, w - 1);
+    y1 = random_int(state, 0, h - 1);
+    x2 = random_int(state, 0, w - 1);
+    y2 = random_int(state, 0, h - 1);
+    x3 = random_int(state, 0, w - 1);
+    y3 = random_int(state, 0, h - 1);
+
+    switch (c->kind) {
+    case FUZZ_DEGENERATE:
+        if (random_int(state, 0, 2) == 0) {
+            /* A point */
+            x2 = x3 = x1;
+            y2 = y3 = y1;
+        } else if (random_int(state, 0, 1)) {
+            /* Two corners coincide */
+            x3 = x2;
+            y3 = y2;
+        } else {
+            /* Collinear: the third corner halfway along the first edge */
+            x3 = (x1 + x2) / 2;
+            y3 = (y1 + y2) / 2;
+            if ((x2 - x1) % 2 || (y2 - y1) % 2) {
+                x2 = x1 + 2 * (x3 - x1);
+                y2 = y1 + 2 * (y3 - y1);
+            }
+        }
+        break;
+    case FUZZ_SLIVER:
+        /* The third corner one pixel off the first edge */
+        x3 = x2 + random_int(state, -1, 1);
+        y3 = y2 + random_int(state, -1, 1);
+        x3 = x3 < 0 ? 0 : (x3 >= w ? w - 1 : x3);
+        y3 = y3 < 0 ? 0 : (y3 >= h ? h - 1 : y3);
+        break;
+    case FUZZ_HUGE:
+        /* Corners on the surface edges */
+        x1 = random_int(state, 0, 1) ? 0 : w - 1;
+        y2 = random_int(state, 0, 1) ? 0 : h - 1;
+        x3 = random_int(state, 0, 1) ? 0 : w - 1;
+        y3 = random_int(state, 0, 1) ? 0 : h - 1;
+        break;
+    case FUZZ_OFFSCREEN:
+        /* Push one coordinate off the surface, just or far */
+        switch (random_int(state, 0, 3)) {
+        case 0: x1 = -random_int(state, 1, 2) * (random_int(state, 0, 1) ? 1 : 50000); break;
+        case 1: x2 = w - 1 + random_int(state, 1, 2); break;
+        case 2: y3 = -random_int(state, 1, 100000); break;
+        default: y1 = h - 1 + random_int(state, 1, 2); break;
+        }
+        break;
+    case FUZZ_MODEL:
+        c->model.x1 = (Sint16)random_int(state, -1000, 1000);
+        c->model.y1 = (Sint16)random_int(state, -1000, 1000);
+        c->model.x2 = (Sint16)random_int(state, -1000, 1000);
+        c->model.y2 = (Sint16)random_int(state, -1000, 1000);
+        c->model.x3 = (Sint16)random_int(state, -1000, 1000);
+        c->model.y3 = (Sint16)random_int(state, -1000, 1000);
+        c->scale = (float)random_int(state, -2000, 2000) / 20000.0f;
+        c->rotation = random_int(state, 0, 3) == 0 ? (float)(90 * random_int(state, -4, 4)) :
+                      (float)random_int(state, -36000, 36000) / 100.0f;
+        c->tx = random_int(state, 0, w - 1);
+        c->ty = random_int(state, 0, h - 1);
+        break;
+    default:
+        break;
+    }
+
+    set_corners(&c->screen, x1, y1, x2, y2, x3, y3);
+}
+
+/* Fill the surface with the case's background noise. */
+static void fill_noise(SDL_Surface *surface, unsigned int seed)
+{
+    Uint32 *pixels = surface->pixels;
+    int i;
+
+    for (i = 0; i < surface->w * surface->h; i++) {
+        pixels[i] = random_color(&seed);
+    }
+}
+
+/* Count the pixels that differ between the surfaces in m; return 1 if any do. */
+static int compare_surfaces(mismatch_t *m)
+{
+    Uint32 *got = actual->pixels, *want = expected->pixels;
+    int i;
+
+    for (i = 0; i < actual->w * actual->h; i++) {
+        if (got[i] != want[i]) {
+            if (m->pixels++ == 0) {
+                m->x = i % actual->w;
+                m->y = i / actual->w;
+                m->got = got[i];
+                m->expected = want[i];
+            }
+        }
+    }
+
+    return m->pixels > 0;
+}
+
+/* Return 1 if every corner of the triangle lies on the surface. */
+static int on_surface(const screentri_t *tri, const SDL_Surface *surface)
+{
+    return tri->sx1 >= 0 && tri->sx1 < surface->w && tri->sy1 >= 0 && tri->sy1 < surface->h &&
+           tri->sx2 >= 0 && tri->sx2 < surface->w && tri->sy2 >= 0 && tri->sy2 < surface->h &&
+           tri->sx3 >= 0 && tri->sx3 < surface->w && tri->sy3 >= 0 && tri->sy3 < surface->h;
+}
+
+/* Run the case through both rasterizers; return 1 and fill in m if they disagree. */
+static int run_case(const fuzzcase_t *c, mismatch_t *m)
+{
+    screentri_t tri, ref;
+
+    memset(m, 0, sizeof(*m));
+    fill_noise(actual, c->noise);
+    fill_noise(expected, c->noise);
+
+    if (c->kind == FUZZ_MODEL) {
+        transform_t transform;
+
+        transform.scale = c->scale;
+        transform_setrotation(&transform, c->rotation);
+        transform.tx = c->tx;
+        transform.ty = c->ty;
+        transform.palette = &c->color;
+        transform_triangle(&c->model, &transform, &tri);
+        refraster_transform(&c->model, &transform, c->rotation, &ref);
+
+        if (tri.sx1 != ref.sx1 || tri.sy1 != ref.sy1 || tri.sx2 != ref.sx2 ||
+            tri.sy2 != ref.sy2 || tri.sx3 != ref.sx3 || tri.sy3 != ref.sy3 ||
+            tri.rect.x != ref.rect.x || tri.rect.y != ref.rect.y ||
+            tri.rect.w != ref.rect.w || tri.rect.h != ref.rect.h ||
+            tri.fillcolor != ref.fillcolor) {
+            m->transform = 1;
+            m->gottri = tri;
+            m->expectedtri = ref;
+            return 1;
+        }
+    } else {
+        tri = c->screen;
+        set_bounds(&tri);
+        tri.fillcolor = c->color;
+        ref = tri;
+    }
+
+    /* The unclipped kernels only take triangles on the surface; refraster culls the rest */
+    if (on_surface(&tri, actual)) {
+        if (c->rasterizer == TRIANGLE_WIREFRAME) {
+            wire_screentriangle(actual, &tri, NULL);
+        } else {
+            fill_screentriangle(actual, &tri, NULL);
+        }
+    }
+    refraster_draw(expected, &ref, c->rasterizer);
+    if (compare_surfaces(m)) {
+        return 1;
+    }
+
+    fill_noise(actual, c->noise);
+    fill_noise(expected, c->noise);
+    draw_clippedtriangle(actual, &tri, c->rasterizer, NULL);
+    refraster_drawclipped(expected, &ref, c->rasterizer);
+    m->clipped = compare_surfaces(m);
+
+    return m->clipped;
+}
+
+/* Return the value one step closer to zero: halved, or 1 nearer. */
+static int shrink_int(int value, int halve)
+{
+    if (halve) {
+        return value / 2;
+    }
+    return value > 0 ? value - 1 : value + 1;
+}
+
+/*
+ * Shrink the failing case: move each coordinate, and the model transform,
+ * towards zero for as long as the case still fails.
+ */
+static void minimize_case(fuzzcase_t *c)
+{
+    int *fields[12];
+    int numfields = 0;
+    int progress = 1;
+    mismatch_t m;
+    fuzzcase_t trial;
+    int i, halve;
+
+    while (progress) {
+        progress = 0;
+
+        /* Integer fields of the working copy, refreshed each pass */
+        numfields = 0;
+        if (c->kind == FUZZ_MODEL) {
+            fields[numfields++] = &c->tx;
+            fields[numfields++] = &c->ty;
+        } else {
+            fields[numfields++] = &c->screen.sx1;
+            fields[numfields++] = &c->screen.sy1;
+            fields[numfields++] = &c->screen.sx2;
+            fields[numfields++] = &c->screen.sy2;
+            fields[numfields++] = &c->screen.sx3;
+            fields[numfields++] = &c->screen.sy3;
+        }
+
+        for (i = 0; i < numfields; i++) {
+            for (halve = 1; halve >= 0; halve--) {
+                int before = *fields[i];
+
+                if (before == 0) {
+                    break;
+                }
+                *fields[i] = shrink_int(before, halve);
+                if (run_case(c, &m)) {
+                    progress = 1;
+                    break;
+                }
+                *fields[i] = before;
+            }
+        }
+
+        if (c->kind == FUZZ_MODEL) {
+            Sint16 *corners[6] = { &c->model.x1, &c->model.y1, &c->model.x2,
+                                   &c->model.y2, &c->model.x3, &c->model.y3 };
+            float rotations[3] = { 0.0f, roundf(c->rotation), c->rotation / 2.0f };
+            float scales[2] = { roundf(c->scale * 64.0f) / 64.0f, c->scale / 2.0f };
+
+            for (i = 0; i < 6; i++) {
+                for (halve = 1; halve >= 0; halve--) {
+                    Sint16 before = *corners[i];
+
+                    if (before == 0) {
+                        break;
+                    }
+                    *corners[i] = (Sint16)shrink_int(before, halve);
+                    if (run_case(c, &m)) {
+                        progress = 1;
+                        break;
+                    }
+                    *corners[i] = before;
+                }
+            }
+            for (i = 0; i < 3; i++) {
+                trial = *c;
+                trial.rotation = rotations[i];
+                if (trial.rotation != c->rotation && run_case(&trial, &m)) {
+                    *c = trial;
+                    progress = 1;
+                    break;
+                }
+            }
+            for (i = 0; i < 2; i++) {
+                trial = *c;
+                trial.scale = scales[i];
+                if (trial.scale != c->scale && run_case(&trial, &m)) {
+                    *c = trial;
+                    progress = 1;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* Print a minimized failing case. */
+static void print_case(int index, const fuzzcase_t *c, const mismatch_t *m)
+{
+    const char *rasterizer = c->rasterizer == TRIANGLE_FILLED ? "filled" : "wireframe";
+
+    fprintf(report, "case %d (%s, %s): ", index, kindnames[c->kind], rasterizer);
+    if (c->kind == FUZZ_MODEL) {
+        fprintf(report, "model %d,%d - %d,%d - %d,%d scale %.9g rotation %.9g at %d,%d",
+                c->model.x1, c->model.y1, c->model.x2, c->model.y2, c->model.x3, c->model.y3,
+                c->scale, c->rotation, c->tx, c->ty);
+    } else {
+        fprintf(report, "triangle %d,%d - %d,%d - %d,%d",
+                c->screen.sx1, c->screen.sy1, c->screen.sx2, c->screen.sy2,
+                c->screen.sx3, c->screen.sy3);
+    }
+    fprintf(report, " color 0x%08x noise %u\n", c->color, c->noise);
+
+    if (m->transform) {
+        const screentri_t *got = &m->gottri, *want = &m->expectedtri;
+
+        fprintf(report, "    transformed to %d,%d - %d,%d - %d,%d box %d,%d %dx%d color 0x%08x\n",
+                got->sx1, got->sy1, got->sx2, got->sy2, got->sx3, got->sy3,
+                got->rect.x, got->rect.y, got->rect.w, got->rect.h, got->fillcolor);
+        fprintf(report, "    expected       %d,%d - %d,%d - %d,%d box %d,%d %dx%d color 0x%08x\n",
+                want->sx1, want->sy1, want->sx2, want->sy2, want->sx3, want->sy3,
+                want->rect.x, want->rect.y, want->rect.w, want->rect.h, want->fillcolor);
+    } else {
+        fprintf(report, "    %ld pixels differ%s, first at %d,%d: got 0x%08x, expected 0x%08x\n",
+                m->pixels, m->clipped ? " when clipped" : "", m->x, m->y, m->got, m->expected);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long cases = FUZZ_CASES;
+    unsigned int seed = 1, state;
+    int width = FUZZ_WIDTH, height = FUZZ_HEIGHT;
+    int reports = FUZZ_REPORTS;
+    long failures = 0, kindcounts[FUZZ_NUMKINDS] = { 0 };
+    fuzzcase_t c;
+    mismatch_t m;
+    long i;
+    int k;
+
+    for (k = 1; k < argc; k++) {
+        if (strcmp(argv[k], "--cases") == 0 && k + 1 < argc) {
+            cases = atol(argv[++k]);
+        } else if (strcmp(argv[k], "--seed") == 0 && k + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++k], NULL, 0);
+        } else if (strcmp(argv[k], "--size") == 0 && k + 1 < argc &&
+                   sscanf(argv[k + 1], "%dx%d", &width, &height) == 2 &&
+                   width >= 4 && height >= 4 && width <= 4096 && height <= 4096) {
+            k++;
+        } else if (strcmp(argv[k], "--reports") == 0 && k + 1 < argc) {
+            reports = atoi(argv[++k]);
+        } else {
+            fprintf(stderr, "Usage: %s [--cases N] [--seed N] [--size WIDTHxHEIGHT] [--reports N]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* The pipeline prints every triangle it culls; keep that out of the report */
+    fflush(stdout);
+    report = fdopen(dup(STDOUT_FILENO), "w");
+    if (!report || !freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "Unable to redirect output\n");
+        return EXIT_FAILURE;
+    }
+
+    actual = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    expected = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!actual || !expected) {
+        fprintf(stderr, "Unable to create surfaces. Error returned: %s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    /* Zero is a fixed point of the generator */
+    state = seed ? seed : 1;
+    for (i = 0; i < cases; i++) {
+        generate_case(&c, &state, width, height);
+        kindcounts[c.kind]++;
+        if (!run_case(&c, &m)) {
+            continue;
+        }
+        if (++failures <= reports) {
+            minimize_case(&c);
+            run_case(&c, &m);
+            print_case((int)i, &c, &m);
+        }
+    }
+
+    fprintf(report, "%ld cases on %dx%d, seed %u:", cases, width, height, seed);
+    for (k = 0; k < FUZZ_NUMKINDS; k++) {
+        fprintf(report, " %ld %s%s", kindcounts[k], kindnames[k], k + 1 < FUZZ_NUMKINDS ? "," : "\n");
+    }
+    fprintf(report, "%ld mismatches\n", failures);
+
+    SDL_FreeSurface(actual);
+    SDL_FreeSurface(expected);
+    fclose(report);
+
+    return failures ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Reference rasterizer module: the pipeline's semantics, written for clarity.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "refraster.h"
+
+typedef void (*plot_fn_t)(void *arg, int x, int y);
+
+/* Return true if (x, y) lies on the surface. */
+static int on_surface(SDL_Surface *surface, int x, int y)
+{
+    return x >= 0 && x < surface->w && y >= 0 && y < surface->h;
+}
+
+/* Return the rounded step along the minor axis: round(k * minor / major), ties up. */
+static int minor_step(int k, int minor, int major)
+{
+    return (2 * minor * k + major) / (2 * major);
+}
+
+/* Call plot for every pixel of the edge from (x1, y1) to (x2, y2). */
+static void walk_edge(int x1, int y1, int x2, int y2, plot_fn_t plot, void *arg)
+{
+    int dx = abs(x2 - x1), sx = x2 < x1 ? -1 : 1;
+    int dy = abs(y2 - y1), sy = y2 < y1 ? -1 : 1;
+    int k;
+
+    if (dx == 0 && dy == 0) {
+        plot(arg, x1, y1);
+    } else if (dx > dy) {
+        for (k = 0; k <= dx; k++) {
+            plot(arg, x1 + sx * k, y1 + sy * minor_step(k, dy, dx));
+        }
+    } else {
+        for (k = 0; k <= dy; k++) {
+            plot(arg, x1 + sx * minor_step(k, dx, dy), y1 + sy * k);
+        }
+    }
+}
+
+typedef struct outline outline_t;
+
+/* Pixels plotted so far, as either direct writes or per-row extents */
+struct outline {
+    SDL_Surface *surface;
+    Uint32      color;
+    int         *minx;      /* Leftmost edge pixel per row, or NULL to write pixels */
+    int         *maxx;      /* Rightmost edge pixel per row */
+};
+
+/* Plot an edge pixel of the outline; pixels and rows off the surface are dropped. */
+static void plot_outline(void *arg, int x, int y)
+{
+    outline_t *outline = arg;
+    Uint32 *pixels = outline->surface->pixels;
+
+    if (y < 0 || y >= outline->surface->h) {
+        return;
+    }
+    if (!outline->minx) {
+        if (on_surface(outline->surface, x, y)) {
+            pixels[y * outline->surface->w + x] = outline->color;
+        }
+        return;
+    }
+    if (x < outline->minx[y]) {
+        outline->minx[y] = x;
+    }
+    if (x > outline->maxx[y]) {
+        outline->maxx[y] = x;
+    }
+}
+
+/* Transform a model triangle to screen space, the way the pipeline does. */
+void refraster_transform(const modeltri_t *triangle, const transform_t *transform,
+                         float rotation, screentri_t *out)
+{
+    float sinr = sinf(rotation * M_PI / 180.0);
+    float cosr = cosf(rotation * M_PI / 180.0);
+    int mx[3] = { triangle->x1, triangle->x2, triangle->x3 };
+    int my[3] = { triangle->y1, triangle->y2, triangle->y3 };
+    int *sx[3] = { &out->sx1, &out->sx2, &out->sx3 };
+    int *sy[3] = { &out->sy1, &out->sy2, &out->sy3 };
+    int minx = 0, miny = 0, maxx = 0, maxy = 0;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        /* Scale and truncate, rotate and truncate, translate */
+        float x = (float)(int)((float)mx[i] * transform->scale);
+        float y = (float)(int)((float)my[i] * transform->scale);
+
+        *sx[i] = (int)(x * cosr - y * sinr) + transform->tx;
+        *sy[i] = (int)(x * sinr + y * cosr) + transform->ty;
+
+        if (i == 0 || *sx[i] < minx) minx = *sx[i];
+        if (i == 0 || *sx[i] > maxx) maxx = *sx[i];
+        if (i == 0 || *sy[i] < miny) miny = *sy[i];
+        if (i == 0 || *sy[i] > maxy) maxy = *sy[i];
+    }
+
+    out->rect.x = minx;
+    out->rect.y = miny;
+    out->rect.w = maxx - minx + 1;
+    out->rect.h = maxy - miny + 1;
+    out->fillcolor = transform->palette[triangle->color];
+}
+
+/* Draw the triangle, keeping only the pixels on the surface. */
+static void draw_outline(SDL_Surface *surface, const screentri_t *triangle, int rasterizer)
+{
+    Uint32 *pixels = surface->pixels;
+    outline_t outline;
+    int x, y;
+
+    outline.surface = surface;
+    outline.color = triangle->fillcolor;
+    outline.minx = NULL;
+    outline.maxx = NULL;
+
+    if (rasterizer == TRIANGLE_FILLED) {
+        outline.minx = malloc(sizeof(int) * surface->h);
+        outline.maxx = malloc(sizeof(int) * surface->h);
+        if (!outline.minx || !outline.maxx) {
+            fprintf(stderr, "Reference rasterizer out of memory\n");
+            free(outline.minx);
+            free(outline.maxx);
+            return;
+        }
+        for (y = 0; y < surface->h; y++) {
+            outline.minx[y] = surface->w;
+            outline.maxx[y] = -1;
+        }
+    }
+
+    walk_edge(triangle->sx1, triangle->sy1, triangle->sx2, triangle->sy2, plot_outline, &outline);
+    walk_edge(triangle->sx2, triangle->sy2, triangle->sx3, triangle->sy3, plot_outline, &outline);
+    walk_edge(triangle->sx3, triangle->sy3, triangle->sx1, triangle->sy1, plot_outline, &outline);
+
+    if (outline.minx) {
+        for (y = 0; y < surface->h; y++) {
+            for (x = outline.minx[y]; x <= outline.maxx[y]; x++) {
+                if (on_surface(surface, x, y)) {
+                    pixels[y * surface->w + x] = triangle->fillcolor;
+                }
+            }
+        }
+        free(outline.minx);
+        free(outline.maxx);
+    }
+}
+
+/* Draw a screen-space triangle with the given rasterizer. */
+void refraster_draw(SDL_Surface *surface, const screentri_t *triangle, int rasterizer)
+{
+    if (!on_surface(surface, triangle->sx1, triangle->sy1) ||
+        !on_surface(surface, triangle->sx2, triangle->sy2) ||
+        !on_surface(surface, triangle->sx3, triangle->sy3)) {
+        return;
+    }
+
+    draw_outline(surface, triangle, rasterizer);
+}
+
+/* Draw a screen-space triangle with the given rasterizer, clipped to the surface. */
+void refraster_drawclipped(SDL_Surface *surface, const screentri_t *triangle, int rasterizer)
+{
+    draw_outline(surface, triangle, rasterizer);
+}
@@ -0,0 +1,48 @@
+#ifndef REFRASTER_H_
+#define REFRASTER_H_
+
+#include <SDL2/SDL.h>
+#include "triangle.h"
+
+/*
+ * Reference rasterizer interface
+ *
+ * A slow, straightforward restatement of what the triangle pipeline
+ * draws, kept as the oracle that optimized kernels are checked against
+ * (see rasterfuzz.c). It shares no code with triangle.c or drawline.c:
+ *
+ *  - A triangle with any corner outside the surface draws nothing,
+ *    unless it is drawn clipped; then the pixels that would lie outside
+ *    the surface are dropped and the rest drawn as usual.
+ *  - An edge covers, for each step along its major axis, the pixel
+ *    nearest the true line, with ties rounded away from the edge's start.
+ *    Edges whose two axes are equally long step along y.
+ *  - TRIANGLE_WIREFRAME sets the three edges to the fill color.
+ *  - TRIANGLE_FILLED sets, on each row, every pixel from the leftmost to
+ *    the rightmost edge pixel to the fill color.
+ *
+ * The optimized pipeline reserves one pen color for outlines it is about
+ * to fill; surfaces and fill colors must not contain it.
+ */
+
+/*
+ * Transform a model triangle to screen space like transform_triangle,
+ * writing the result to out. The rotation is worked out from the given
+ * angle in degrees; the transform's matrix is not used, so a wrong matrix
+ * from transform_setrotation shows up as a mismatch.
+ */
+void refraster_transform(const modeltri_t *triangle, const transform_t *transform,
+                         float rotation, screentri_t *out);
+
+/*
+ * Draw a screen-space triangle on the surface with the given rasterizer.
+ */
+void refraster_draw(SDL_Surface *surface, const screentri_t *triangle, int rasterizer);
+
+/*
+ * Draw a screen-space triangle on the surface like refraster_draw, clipped
+ * to the surface the way draw_clippedtriangle does.
+ */
+void refraster_drawclipped(SDL_Surface *surface, const screentri_t *triangle, int rasterizer);
+
+#endif /*REFRASTER_H_*/
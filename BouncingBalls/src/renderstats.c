@@ -0,0 +1,120 @@
+/*
+ * Render counters module: per-frame pipeline work and overdraw.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "renderstats.h"
+
+/* Number of Uint32 words in the coverage bitmap */
+static size_t coverage_words(const renderstats_t *stats)
+{
+    return ((size_t)stats->width * stats->height + 31) / 32;
+}
+
+/* Return newly created counters for a width x height surface. */
+renderstats_t *renderstats_create(int width, int height)
+{
+    renderstats_t *stats;
+
+    if (width <= 0 || height <= 0) {
+        return NULL;
+    }
+
+    stats = calloc(1, sizeof(*stats));
+    if (!stats) {
+        return NULL;
+    }
+
+    stats->width = width;
+    stats->height = height;
+    stats->coverage = calloc(coverage_words(stats), sizeof(Uint32));
+    if (!stats->coverage) {
+        free(stats);
+        return NULL;
+    }
+
+    return stats;
+}
+
+/* Free the counters. */
+void renderstats_destroy(renderstats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    free(stats->coverage);
+    free(stats);
+}
+
+/* Zero the counters and the coverage bitmap for a new frame. */
+void renderstats_beginframe(renderstats_t *stats)
+{
+    stats->objects = 0;
+    stats->offscreen = 0;
+    stats->submitted = 0;
+    stats->culled = 0;
+    stats->clipped = 0;
+    stats->drawn = 0;
+    stats->pixels = 0;
+    stats->covered = 0;
+    memset(stats->coverage, 0, coverage_words(stats) * sizeof(Uint32));
+}
+
+/* Count the distinct pixels covered in the frame. */
+void renderstats_endframe(renderstats_t *stats)
+{
+    size_t i, n = coverage_words(stats);
+    long covered = 0;
+
+    for (i = 0; i < n; i++) {
+        covered += __builtin_popcount(stats->coverage[i]);
+    }
+    stats->covered = covered;
+}
+
+/* Count one pixel; writes outside the surface are not pixels written. */
+void renderstats_pixel(renderstats_t *stats, int x, int y)
+{
+    size_t bit;
+
+    if (x < 0 || x >= stats->width || y < 0 || y >= stats->height) {
+        return;
+    }
+
+    bit = (size_t)y * stats->width + x;
+    stats->coverage[bit / 32] |= 1u << (bit % 32);
+    stats->pixels++;
+}
+
+/* Count a horizontal span of pixels. */
+void renderstats_span(renderstats_t *stats, int x1, int x2, int y)
+{
+    int x;
+
+    for (x = x1; x <= x2; x++) {
+        renderstats_pixel(stats, x, y);
+    }
+}
+
+/* Return pixels written per pixel covered. */
+double renderstats_overdraw(const renderstats_t *stats)
+{
+    return stats->covered > 0 ? (double)stats->pixels / stats->covered : 0.0;
+}
+
+/* Write the CSV column names. */
+void renderstats_csvheader(FILE *file)
+{
+    fprintf(file, "frame,objects,offscreen,submitted,culled,clipped,drawn,pixels,covered,overdraw\n");
+}
+
+/* Write one CSV row with the frame's counters. */
+void renderstats_csvrow(FILE *file, int frame, const renderstats_t *stats)
+{
+    fprintf(file, "%d,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%.4f\n",
+            frame, stats->objects, stats->offscreen, stats->submitted, stats->culled, stats->clipped,
+            stats->drawn, stats->pixels, stats->covered, renderstats_overdraw(stats));
+}
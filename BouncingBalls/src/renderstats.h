@@ -0,0 +1,76 @@
+#ifndef RENDERSTATS_H_
+#define RENDERSTATS_H_
+
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+/*
+ * Render counters interface
+ *
+ * Counts the work the triangle pipeline does in a frame: objects drawn and
+ * skipped as off the surface, triangles submitted, triangles culled by the
+ * surface bounds check, clipped and drawn, and pixels written. A coverage
+ * bitmap with one bit per surface pixel records which pixels were written
+ * at least once, so the overdraw ratio is pixels written / pixels covered.
+ * The pipeline only counts when it is handed a renderstats_t, so counting
+ * costs nothing when off.
+ */
+
+typedef struct renderstats renderstats_t;
+
+struct renderstats {
+    long    objects;        /* Objects drawn */
+    long    offscreen;      /* Objects skipped as wholly outside the surface */
+    long    submitted;      /* Triangles handed to the pipeline */
+    long    culled;         /* Triangles rejected as outside the surface */
+    long    clipped;        /* Triangles cut to the surface before drawing */
+    long    drawn;          /* Triangles rasterized */
+    long    pixels;         /* Pixel writes, outlines and fill */
+    long    covered;        /* Distinct pixels written; set by renderstats_endframe */
+
+    Uint32  *coverage;      /* One bit per surface pixel */
+    int     width, height;  /* Size of the coverage bitmap in pixels */
+};
+
+/*
+ * Return newly created counters for a width x height surface, or NULL.
+ */
+renderstats_t *renderstats_create(int width, int height);
+
+/*
+ * Free the counters.
+ */
+void renderstats_destroy(renderstats_t *stats);
+
+/*
+ * Zero the counters and the coverage bitmap for a new frame.
+ */
+void renderstats_beginframe(renderstats_t *stats);
+
+/*
+ * Count the distinct pixels covered in the frame.
+ */
+void renderstats_endframe(renderstats_t *stats);
+
+/*
+ * Count one pixel written at (x, y). Pixels off the surface are ignored.
+ */
+void renderstats_pixel(renderstats_t *stats, int x, int y);
+
+/*
+ * Count a horizontal span of pixels from x1 to x2 inclusive on row y.
+ */
+void renderstats_span(renderstats_t *stats, int x1, int x2, int y);
+
+/*
+ * Return pixels written per pixel covered, or 0 if nothing was drawn.
+ */
+double renderstats_overdraw(const renderstats_t *stats);
+
+/*
+ * Write the CSV column names, and one CSV row with the frame's counters.
+ */
+void renderstats_csvheader(FILE *file);
+void renderstats_csvrow(FILE *file, int frame, const renderstats_t *stats);
+
+#endif /*RENDERSTATS_H_*/
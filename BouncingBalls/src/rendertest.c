@@ -0,0 +1,495 @@
+/*
+ * Golden-image rendering tests with a frame time regression gate.
+ *
+ * Each scene is a fixed, seeded arrangement of sphere or teapot objects,
+ * drawn headless with one of the rasterizers (balls may first be moved by
+ * the physics step). The frame is compared against a golden image in
+ * testdata/, allowing the per-rasterizer tolerance: a pixel only counts as
+ * different if a channel is off by more than the channel tolerance, and
+ * the scene fails if more than the pixel tolerance fraction differ.
+ *
+ * Each scene is also rendered repeatedly and its median frame time
+ * compared with testdata/baseline.txt; the scene fails if it is slower
+ * than the baseline by more than the threshold. Baselines depend on the
+ * machine, so regenerate them (--update) on the machine that runs the gate;
+ * make test passes --noperf and only make perftest applies the gate.
+ *
+ * Usage: rendertest [--update] [--noperf] [--threshold FRACTION]
+ *                   [--tolerance fill|wireframe:CHANNEL:FRACTION]...
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "backend.h"
+#include "triangle.h"
+#include "model.h"
+#include "object.h"
+#include "physics.h"
+#include "config.h"
+#include "arena.h"
+
+#define TEST_WIDTH      320
+#define TEST_HEIGHT     240
+#define TEST_DIR        "testdata"
+#define TEST_BASELINE   TEST_DIR "/baseline.txt"
+#define TEST_TIMINGREPS 15      /* Renders timed per scene */
+#define TEST_THRESHOLD  0.5     /* Allowed slowdown over the baseline */
+#define TEST_MAXSCENES  16
+
+typedef struct tolerance tolerance_t;
+
+/* How far a frame may stray from its golden image */
+struct tolerance {
+    int     channel;    /* Largest per-channel difference still counted as equal */
+    double  pixels;     /* Largest fraction of pixels allowed to differ */
+};
+
+/* Indexed by rasterizer */
+static tolerance_t tolerances[] = {
+    [TRIANGLE_FILLED]    = { 4, 0.001 },
+    [TRIANGLE_WIREFRAME] = { 4, 0.002 },
+};
+
+static const char *rasterizernames[] = {
+    [TRIANGLE_FILLED]    = "fill",
+    [TRIANGLE_WIREFRAME] = "wireframe",
+};
+
+typedef struct scene scene_t;
+
+struct scene {
+    const char  *name;
+    const char  *model;
+    int         rasterizer;
+    int         numobjects;
+    float       minscale, maxscale;
+    int         rotate;         /* 1 gives objects random rotations, 2 random spins too */
+    int         steps;          /* Physics steps before drawing */
+    float       lodpixels;      /* Level of detail threshold; 0 draws full detail */
+    int         impostorpixels; /* Largest radius drawn as a disc; 0 never */
+    int         edges;          /* Scatter objects across and past the surface edges */
+    unsigned int seed;
+};
+
+static const scene_t scenes[] = {
+    { "sphere-fill",      "sphere.bbm", TRIANGLE_FILLED,    12, 0.04f, 0.12f, 0, 0,  0.0f, 0,  0, 1 },
+    { "sphere-wireframe", "sphere.bbm", TRIANGLE_WIREFRAME, 12, 0.04f, 0.12f, 0, 0,  0.0f, 0,  0, 2 },
+    { "teapot-fill",      "teapot.bbm", TRIANGLE_FILLED,    6,  0.06f, 0.14f, 1, 0,  0.0f, 0,  0, 3 },
+    { "teapot-wireframe", "teapot.bbm", TRIANGLE_WIREFRAME, 6,  0.06f, 0.14f, 1, 0,  0.0f, 0,  0, 4 },
+    { "sphere-physics",   "sphere.bbm", TRIANGLE_FILLED,    30, 0.03f, 0.08f, 0, 90, 0.0f, 0,  0, 5 },
+    { "sphere-lod",       "sphere.bbm", TRIANGLE_FILLED,    24, 0.01f, 0.07f, 0, 0,  6.0f, 0,  0, 6 },
+    { "teapot-lod",       "teapot.bbm", TRIANGLE_WIREFRAME, 12, 0.02f, 0.10f, 1, 0,  6.0f, 0,  0, 7 },
+    { "sphere-impostor",  "sphere.bbm", TRIANGLE_FILLED,    40, 0.01f, 0.07f, 0, 0,  0.0f, 16, 0, 8 },
+    { "teapot-edges",     "teapot.bbm", TRIANGLE_FILLED,    16, 0.06f, 0.14f, 1, 0,  0.0f, 0,  1, 9 },
+    { "sphere-edges",     "sphere.bbm", TRIANGLE_WIREFRAME, 16, 0.04f, 0.12f, 0, 0,  0.0f, 0,  1, 10 },
+    { "teapot-spin",      "teapot.bbm", TRIANGLE_FILLED,    8,  0.06f, 0.12f, 2, 45, 0.0f, 0,  0, 11 },
+    { "impostor-wireframe", "sphere.bbm", TRIANGLE_WIREFRAME, 40, 0.01f, 0.07f, 0, 0, 0.0f, 16, 0, 12 },
+};
+
+#define NUM_SCENES  ((int)(sizeof(scenes) / sizeof(scenes[0])))
+
+/* Frame time baselines, by scene index; negative if none is stored */
+static double baselines[NUM_SCENES];
+
+/*
+ * Return the next number from a xorshift generator. The C library's rand
+ * differs between platforms, and the scenes must not.
+ */
+static unsigned int next_random(unsigned int *state)
+{
+    unsigned int x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+/* Return a random float in [lo, hi]. */
+static float random_range(unsigned int *state, float lo, float hi)
+{
+    return lo + (hi - lo) * (float)(next_random(state) % 10001) / 10000.0f;
+}
+
+/* Return the distance from the model origin to its farthest corner. */
+static float model_radius(const model_t *model)
+{
+    float radius = 0.0f, r;
+    int i;
+
+    for (i = 0; i < model->numtriangles; i++) {
+        const modeltri_t *tri = &model->triangles[i];
+
+        r = sqrtf((float)(tri->x1 * tri->x1 + tri->y1 * tri->y1));
+        radius = r > radius ? r : radius;
+        r = sqrtf((float)(tri->x2 * tri->x2 + tri->y2 * tri->y2));
+        radius = r > radius ? r : radius;
+        r = sqrtf((float)(tri->x3 * tri->x3 + tri->y3 * tri->y3));
+        radius = r > radius ? r : radius;
+    }
+
+    return radius;
+}
+
+/* Create the scene's objects; they stay entirely on the surface unless the scene has edges set. */
+static void build_scene(const scene_t *scene, SDL_Surface *surface, const model_t *model)
+{
+    unsigned int state = scene->seed * 2654435761u + 1;
+    float radius = model_radius(model);
+    physics_t physics;
+    config_t config;
+    int i, k;
+
+    for (i = 0; i < scene->numobjects; i++) {
+        object_t *object = create_object(surface, model);
+        float margin;
+
+        if (!object) {
+            fprintf(stderr, "Failed to create object %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+        object->scale = random_range(&state, scene->minscale, scene->maxscale);
+        margin = radius * object->scale * (scene->edges ? -1.0f : 1.0f) + 12.0f;
+        object->tx = random_range(&state, margin, surface->w - margin);
+        object->ty = random_range(&state, margin, surface->h - margin);
+        object->speedx = random_range(&state, -8.0f, 8.0f);
+        object->speedy = random_range(&state, -6.0f, 4.0f);
+        if (scene->rotate) {
+            object->rotation = random_range(&state, 0.0f, 360.0f);
+        }
+        if (scene->rotate > 1) {
+            object->spin = random_range(&state, 1.0f, PHYSICS_MAXSPIN);
+            object->rotation_way = next_random(&state) % 2 ? 1 : -1;
+        }
+    }
+
+    config_default(&config);
+    physics.gravity = config.gravity;
+    physics.air = config.air;
+    physics.bounce = config.bounce;
+    physics.restspeed = config.restspeed;
+    physics.width = surface->w;
+    physics.height = surface->h;
+    for (k = 0; k < scene->steps; k++) {
+        for (i = 0; i < object_count(); i++) {
+            physics_step(object_at(i), &physics);
+        }
+    }
+}
+
+/* Clear the surface and draw every object in creation order. */
+static void render_scene(SDL_Surface *surface, drawcontext_t *context)
+{
+    int i;
+
+    SDL_FillRect(surface, NULL, 0x00000000);
+    arena_reset(context->frame);
+    for (i = 0; i < object_count(); i++) {
+        draw_object(object_at(i), context);
+    }
+}
+
+/* Write the surface as a binary PPM image. */
+static int write_ppm(SDL_Surface *surface, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    Uint32 *pixels = surface->pixels;
+    unsigned char rgb[3];
+    int x, y, ok = 1;
+
+    if (!file) {
+        fprintf(stderr, "Unable to create %s\n", path);
+        return 0;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", surface->w, surface->h);
+    for (y = 0; y < surface->h && ok; y++) {
+        for (x = 0; x < surface->w; x++) {
+            Uint32 color = pixels[y * surface->w + x];
+
+            rgb[0] = (color >> 16) & 0xff;
+            rgb[1] = (color >> 8) & 0xff;
+            rgb[2] = color & 0xff;
+            if (fwrite(rgb, 3, 1, file) != 1) {
+                ok = 0;
+                break;
+            }
+        }
+    }
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Unable to write %s\n", path);
+    }
+
+    return ok;
+}
+
+/* Read a binary PPM image of the given size as RGB bytes; NULL on error. */
+static unsigned char *read_ppm(const char *path, int width, int height)
+{
+    FILE *file = fopen(path, "rb");
+    unsigned char *rgb;
+    int w, h, maxval;
+
+    if (!file) {
+        fprintf(stderr, "Missing golden image %s; run rendertest --update\n", path);
+        return NULL;
+    }
+    if (fscanf(file, "P6 %d %d %d", &w, &h, &maxval) != 3 || fgetc(file) == EOF ||
+        w != width || h != height || maxval != 255) {
+        fprintf(stderr, "%s is not a %dx%d PPM image\n", path, width, height);
+        fclose(file);
+        return NULL;
+    }
+
+    rgb = malloc((size_t)width * height * 3);
+    if (rgb && fread(rgb, (size_t)width * height * 3, 1, file) != 1) {
+        fprintf(stderr, "Truncated golden image %s\n", path);
+        free(rgb);
+        rgb = NULL;
+    }
+    fclose(file);
+
+    return rgb;
+}
+
+/* Return the number of pixels that differ from the golden image beyond the channel tolerance. */
+static long compare_golden(SDL_Surface *surface, const unsigned char *golden, int channel)
+{
+    Uint32 *pixels = surface->pixels;
+    long differing = 0;
+    int i, n = surface->w * surface->h;
+
+    for (i = 0; i < n; i++) {
+        const unsigned char *expected = &golden[i * 3];
+        int r = (int)((pixels[i] >> 16) & 0xff) - expected[0];
+        int g = (int)((pixels[i] >> 8) & 0xff) - expected[1];
+        int b = (int)(pixels[i] & 0xff) - expected[2];
+
+        if (abs(r) > channel || abs(g) > channel || abs(b) > channel) {
+            differing++;
+        }
+    }
+
+    return differing;
+}
+
+/* qsort comparator for doubles. */
+static int compare_double(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
+
+/* Return the median time in ms to render the scene. */
+static double time_scene(SDL_Surface *surface, drawcontext_t *context)
+{
+    double samples[TEST_TIMINGREPS];
+    double tickms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+    Uint64 start;
+    int i;
+
+    /* One untimed render so the arena has grown and the model is paged in */
+    render_scene(surface, context);
+    for (i = 0; i < TEST_TIMINGREPS; i++) {
+        start = SDL_GetPerformanceCounter();
+        render_scene(surface, context);
+        samples[i] = (double)(SDL_GetPerformanceCounter() - start) * tickms;
+    }
+    qsort(samples, TEST_TIMINGREPS, sizeof(double), compare_double);
+
+    return samples[TEST_TIMINGREPS / 2];
+}
+
+/* Load the stored frame time baselines, if any. */
+static void read_baselines(void)
+{
+    char name[64];
+    double ms;
+    FILE *file;
+    int i;
+
+    for (i = 0; i < NUM_SCENES; i++) {
+        baselines[i] = -1.0;
+    }
+
+    file = fopen(TEST_BASELINE, "r");
+    if (!file) {
+        return;
+    }
+    while (fscanf(file, " %63s %lf", name, &ms) == 2) {
+        for (i = 0; i < NUM_SCENES; i++) {
+            if (strcmp(scenes[i].name, name) == 0) {
+                baselines[i] = ms;
+            }
+        }
+    }
+    fclose(file);
+}
+
+/* Store the frame time baselines. */
+static int write_baselines(const double *times)
+{
+    FILE *file = fopen(TEST_BASELINE, "w");
+    int i;
+
+    if (!file) {
+        fprintf(stderr, "Unable to create %s\n", TEST_BASELINE);
+        return 0;
+    }
+    for (i = 0; i < NUM_SCENES; i++) {
+        fprintf(file, "%s %.4f\n", scenes[i].name, times[i]);
+    }
+
+    return fclose(file) == 0;
+}
+
+/* Parse a --tolerance argument of the form RASTERIZER:CHANNEL:FRACTION. */
+static int parse_tolerance(const char *arg)
+{
+    char name[16];
+    int channel;
+    double pixels;
+    int i;
+
+    if (sscanf(arg, "%15[^:]:%d:%lf", name, &channel, &pixels) != 3 ||
+        channel < 0 || channel > 255 || pixels < 0.0 || pixels > 1.0) {
+        return 0;
+    }
+    for (i = 0; i < (int)(sizeof(rasterizernames) / sizeof(rasterizernames[0])); i++) {
+        if (strcmp(rasterizernames[i], name) == 0) {
+            tolerances[i].channel = channel;
+            tolerances[i].pixels = pixels;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    double times[NUM_SCENES];
+    double threshold = TEST_THRESHOLD;
+    int update = 0, perf = 1, failures = 0;
+    backend_t *backend;
+    SDL_Surface *surface;
+    drawcontext_t context;
+    char path[256];
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = 1;
+        } else if (strcmp(argv[i], "--noperf") == 0) {
+            perf = 0;
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc && atof(argv[i + 1]) >= 0.0) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc &&
+                   parse_tolerance(argv[i + 1])) {
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--update] [--noperf] [--threshold FRACTION]\n"
+                    "       [--tolerance fill|wireframe:CHANNEL:FRACTION]...\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    backend = backend_create(BACKEND_HEADLESS, TEST_WIDTH, TEST_HEIGHT, NULL);
+    if (!backend) {
+        return EXIT_FAILURE;
+    }
+    surface = backend_surface(backend);
+    context.frame = arena_create(256 * 1024);
+    context.stats = NULL;
+    context.lodhysteresis = 0.2f;
+    read_baselines();
+
+    for (i = 0; i < NUM_SCENES; i++) {
+        const scene_t *scene = &scenes[i];
+        const tolerance_t *tolerance = &tolerances[scene->rasterizer];
+        model_t *model = model_load(scene->model);
+        unsigned char *golden;
+        long differing, allowed;
+        int ok = 1;
+
+        if (!model) {
+            fprintf(stderr, "Failed to load %s; run make to generate it\n", scene->model);
+            return EXIT_FAILURE;
+        }
+        context.rasterizer = scene->rasterizer;
+        context.lodpixels = scene->lodpixels;
+        context.impostorpixels = scene->impostorpixels;
+        build_scene(scene, surface, model);
+        render_scene(surface, &context);
+        snprintf(path, sizeof(path), "%s/%s.ppm", TEST_DIR, scene->name);
+
+        if (update) {
+            if (!write_ppm(surface, path)) {
+                failures++;
+            }
+            times[i] = time_scene(surface, &context);
+            printf("%-18s updated, %.3f ms\n", scene->name, times[i]);
+        } else {
+            golden = read_ppm(path, TEST_WIDTH, TEST_HEIGHT);
+            if (!golden) {
+                ok = 0;
+            } else {
+                differing = compare_golden(surface, golden, tolerance->channel);
+                allowed = (long)(tolerance->pixels * TEST_WIDTH * TEST_HEIGHT);
+                if (differing > allowed) {
+                    snprintf(path, sizeof(path), "rendertest-%s.ppm", scene->name);
+                    write_ppm(surface, path);
+                    printf("%-18s FAIL: %ld pixels differ (%ld allowed); frame saved to %s\n",
+                           scene->name, differing, allowed, path);
+                    ok = 0;
+                }
+                free(golden);
+            }
+
+            if (ok && perf) {
+                times[i] = time_scene(surface, &context);
+                if (baselines[i] < 0.0) {
+                    printf("%-18s ok, %.3f ms (no baseline)\n", scene->name, times[i]);
+                } else if (times[i] > baselines[i] * (1.0 + threshold)) {
+                    printf("%-18s FAIL: %.3f ms, baseline %.3f ms (+%.0f%% allowed)\n",
+                           scene->name, times[i], baselines[i], threshold * 100.0);
+                    ok = 0;
+                } else {
+                    printf("%-18s ok, %.3f ms (baseline %.3f ms)\n", scene->name, times[i], baselines[i]);
+                }
+            } else if (ok) {
+                printf("%-18s ok\n", scene->name);
+            }
+            if (!ok) {
+                failures++;
+            }
+        }
+
+        destroy_all_objects();
+        model_destroy(model);
+    }
+
+    if (update && failures == 0 && !write_baselines(times)) {
+        failures++;
+    }
+
+    arena_destroy(context.frame);
+    backend_destroy(backend);
+
+    if (failures) {
+        printf("%d of %d scenes failed\n", failures, NUM_SCENES);
+        return EXIT_FAILURE;
+    }
+    printf("All %d scenes passed\n", NUM_SCENES);
+
+    return 0;
+}
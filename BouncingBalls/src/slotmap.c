@@ -0,0 +1,202 @@
+/*
+ * Slot map implementation: generational handles over a dense item array.
+ */
+#include <stdlib.h>
+#include "slotmap.h"
+
+#define INDEX_MASK      ((uint32_t)SLOTMAP_MAXITEMS - 1)
+#define GENERATION_MAX  ((uint32_t)0xffffffff >> SLOTMAP_INDEXBITS)
+#define NO_SLOT         ((uint32_t)0xffffffff)
+
+/*
+ * A slot either points at its item's dense position, or, while unused,
+ * at the next free slot. Generations start at 1 so no handle is 0.
+ */
+typedef struct slot slot_t;
+
+struct slot {
+    uint32_t generation;
+    uint32_t position;      /* Dense position, or next free slot when unused */
+};
+
+struct slotmap {
+    slot_t   *slots;
+    void     **items;       /* Dense item array */
+    uint32_t *owners;       /* Slot index owning each dense position */
+    uint32_t capacity;      /* Allocated length of all three arrays */
+    uint32_t numslots;      /* Slots handed out so far */
+    uint32_t numitems;
+    uint32_t freeslot;      /* Head of the free slot list */
+};
+
+/* Return a newly created, empty slot map. */
+slotmap_t *slotmap_create(void)
+{
+    slotmap_t *map = malloc(sizeof(*map));
+
+    if (!map) {
+        return NULL;
+    }
+
+    map->slots = NULL;
+    map->items = NULL;
+    map->owners = NULL;
+    map->capacity = 0;
+    map->numslots = 0;
+    map->numitems = 0;
+    map->freeslot = NO_SLOT;
+
+    return map;
+}
+
+/* Free the slot map, but not the items it holds. */
+void slotmap_destroy(slotmap_t *map)
+{
+    if (!map) {
+        return;
+    }
+
+    free(map->slots);
+    free(map->items);
+    free(map->owners);
+    free(map);
+}
+
+/* Double the capacity of all arrays. Return 0 on failure. */
+static int slotmap_grow(slotmap_t *map)
+{
+    uint32_t capacity = map->capacity ? map->capacity * 2 : 64;
+    slot_t *slots;
+    void **items;
+    uint32_t *owners;
+
+    if (capacity > SLOTMAP_MAXITEMS) {
+        capacity = SLOTMAP_MAXITEMS;
+    }
+    if (capacity <= map->capacity) {
+        return 0;
+    }
+
+    slots = realloc(map->slots, sizeof(*slots) * capacity);
+    if (!slots) {
+        return 0;
+    }
+    map->slots = slots;
+
+    items = realloc(map->items, sizeof(*items) * capacity);
+    if (!items) {
+        return 0;
+    }
+    map->items = items;
+
+    owners = realloc(map->owners, sizeof(*owners) * capacity);
+    if (!owners) {
+        return 0;
+    }
+    map->owners = owners;
+
+    map->capacity = capacity;
+
+    return 1;
+}
+
+/* Return the slot named by handle if it is live, NULL otherwise. */
+static slot_t *slotmap_lookup(slotmap_t *map, slothandle_t handle)
+{
+    uint32_t index = handle & INDEX_MASK;
+    slot_t *slot;
+
+    if (!map || index >= map->numslots) {
+        return NULL;
+    }
+
+    slot = &map->slots[index];
+    if (slot->generation != (handle >> SLOTMAP_INDEXBITS)) {
+        return NULL;
+    }
+
+    return slot;
+}
+
+/* Store item in the map and return its handle. */
+slothandle_t slotmap_insert(slotmap_t *map, void *item)
+{
+    uint32_t index;
+    slot_t *slot;
+
+    if (!map) {
+        return SLOTMAP_NULL;
+    }
+
+    if (map->freeslot != NO_SLOT) {
+        /* Reuse a free slot; it keeps the generation set when it was erased. */
+        index = map->freeslot;
+        slot = &map->slots[index];
+        map->freeslot = slot->position;
+    } else {
+        if (map->numslots == map->capacity && !slotmap_grow(map)) {
+            return SLOTMAP_NULL;
+        }
+        index = map->numslots++;
+        slot = &map->slots[index];
+        slot->generation = 1;
+    }
+
+    slot->position = map->numitems;
+    map->items[map->numitems] = item;
+    map->owners[map->numitems] = index;
+    map->numitems++;
+
+    return (slot->generation << SLOTMAP_INDEXBITS) | index;
+}
+
+/* Return the item named by handle, or NULL if the handle is stale. */
+void *slotmap_get(slotmap_t *map, slothandle_t handle)
+{
+    slot_t *slot = slotmap_lookup(map, handle);
+
+    return slot ? map->items[slot->position] : NULL;
+}
+
+/* Remove the item named by handle, filling its hole with the last item. */
+int slotmap_erase(slotmap_t *map, slothandle_t handle)
+{
+    slot_t *slot = slotmap_lookup(map, handle);
+    uint32_t position, last;
+
+    if (!slot) {
+        return 0;
+    }
+
+    position = slot->position;
+    last = map->numitems - 1;
+    if (position != last) {
+        map->items[position] = map->items[last];
+        map->owners[position] = map->owners[last];
+        map->slots[map->owners[position]].position = position;
+    }
+    map->numitems--;
+
+    /* Retire the handle; wrap around without ever producing generation 0. */
+    slot->generation = slot->generation == GENERATION_MAX ? 1 : slot->generation + 1;
+    slot->position = map->freeslot;
+    map->freeslot = (uint32_t)(slot - map->slots);
+
+    return 1;
+}
+
+/* Return the number of items in the map. */
+int slotmap_size(slotmap_t *map)
+{
+    return map ? (int)map->numitems : 0;
+}
+
+/* Return the item at the given dense position. */
+void *slotmap_at(slotmap_t *map, int index)
+{
+    if (!map || index < 0 || (uint32_t)index >= map->numitems) {
+        return NULL;
+    }
+
+    return map->items[index];
+}
@@ -0,0 +1,64 @@
+#ifndef SLOTMAP_H_
+#define SLOTMAP_H_
+
+#include <stdint.h>
+
+/*
+ * Slot map interface
+ *
+ * A slot map stores item pointers densely and names them by 32-bit handles.
+ * A handle holds a slot index and the slot's generation; erasing an item
+ * bumps the generation, so old handles to it are detected as stale instead
+ * of dangling. Insert, erase and lookup are O(1), and items can be iterated
+ * densely by index, 0 to slotmap_size() - 1. Erasing moves the last item
+ * into the hole, so dense indices are not stable across erases.
+ */
+
+struct slotmap;
+typedef struct slotmap slotmap_t;
+
+typedef uint32_t slothandle_t;
+
+/* Handle value that never refers to an item */
+#define SLOTMAP_NULL    ((slothandle_t)0)
+
+/* Number of handle bits used for the slot index; the rest is the generation */
+#define SLOTMAP_INDEXBITS   20
+#define SLOTMAP_MAXITEMS    (1 << SLOTMAP_INDEXBITS)
+
+/*
+ * Returns a newly created, empty slot map.
+ */
+slotmap_t *slotmap_create(void);
+
+/*
+ * Frees the slot map, but not the items it holds.
+ */
+void slotmap_destroy(slotmap_t *map);
+
+/*
+ * Store item in the map and return its handle, or SLOTMAP_NULL on failure.
+ */
+slothandle_t slotmap_insert(slotmap_t *map, void *item);
+
+/*
+ * Return the item named by handle, or NULL if the handle is stale or invalid.
+ */
+void *slotmap_get(slotmap_t *map, slothandle_t handle);
+
+/*
+ * Remove the item named by handle. Return 1 if it was removed, 0 if stale.
+ */
+int slotmap_erase(slotmap_t *map, slothandle_t handle);
+
+/*
+ * Return the number of items in the map.
+ */
+int slotmap_size(slotmap_t *map);
+
+/*
+ * Return the item at dense position index, 0 <= index < slotmap_size().
+ */
+void *slotmap_at(slotmap_t *map, int index);
+
+#endif /*SLOTMAP_H_*/
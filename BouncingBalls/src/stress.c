@@ -0,0 +1,308 @@
+/*
+ * Stress module: ramping ball counts and surface sizes headless.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "stress.h"
+#include "backend.h"
+#include "ilist.h"
+#include "model.h"
+#include "object.h"
+#include "physics.h"
+#include "workers.h"
+
+/* Surface sizes, then ball counts, that the ramp steps through */
+static const int sizes[][2] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 } };
+static const int counts[] = { 10, 100, 1000, 10000, 100000 };
+
+#define NUM_SIZES   ((int)(sizeof(sizes) / sizeof(sizes[0])))
+#define NUM_COUNTS  ((int)(sizeof(counts) / sizeof(counts[0])))
+
+typedef struct stressstep stressstep_t;
+
+/* Measurements of one step of the ramp */
+struct stressstep {
+    int     width, height;
+    int     balls;
+    double  spawn;          /* us per ball spawned */
+    double  physics;        /* Median ms per frame */
+    double  render;         /* Negative if the step was not rendered */
+    int     frames;         /* Frames timed */
+    double  frame;          /* Median ms per frame, physics and render together */
+    double  expire;         /* us per ball removed */
+};
+
+/* qsort comparator for doubles. */
+static int compare_double(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
+
+/* Return the median of count samples, reordering them. */
+static double median(double *samples, int count)
+{
+    qsort(samples, count, sizeof(double), compare_double);
+    return samples[count / 2];
+}
+
+/* Print the scaling exponent from one step to the next, or fill if unknown. */
+static void print_slope(FILE *file, const char *format, const char *fill,
+                        double time1, int count1, double time2, int count2)
+{
+    if (time1 <= 0.0 || time2 <= 0.0) {
+        fprintf(file, "%s", fill);
+        return;
+    }
+    fprintf(file, format, log(time2 / time1) / log((double)count2 / count1));
+}
+
+/* Print a time, or fill if it was not measured. */
+static void print_time(FILE *file, const char *format, const char *fill, double time)
+{
+    if (time < 0.0) {
+        fprintf(file, "%s", fill);
+        return;
+    }
+    fprintf(file, format, time);
+}
+
+/*
+ * Return the frames to time for a step of count balls, or 0 to leave it
+ * unrendered, given the step before it at the same size or NULL.
+ */
+static int render_frames(const config_t *config, const stressstep_t *prev, int count)
+{
+    double budget = config->stressbudget * 1000.0;
+    double frames;
+
+    if (!prev) {
+        return STRESS_FRAMES;
+    }
+    if (prev->render < 0.0) {
+        return 0;
+    }
+
+    /* The extra frame is the rendered warm-up frame */
+    frames = budget / (prev->render * count / prev->balls) - 1.0;
+    if (frames < STRESS_MINFRAMES) {
+        return 0;
+    }
+
+    return frames > STRESS_FRAMES ? STRESS_FRAMES : (int)frames;
+}
+
+/*
+ * Run one step of the ramp on the surface, rendering the given number of
+ * timed frames, or none. If not every ball can be created, step->balls is
+ * lowered to the number that was. Return 0 if the step could not be set up.
+ */
+static int run_step(SDL_Surface *surface, const model_t *model, workers_t *workers,
+                     const config_t *config, int renderframes, stressstep_t *step)
+{
+    double tickms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+    double physicstimes[STRESS_FRAMES], rendertimes[STRESS_FRAMES], frametimes[STRESS_FRAMES];
+    ilist_t balls;
+    ilink_t *link, *tmp;
+    physics_t physics;
+    drawcontext_t context;
+    Uint64 start, mid, end;
+    int frame, created;
+
+    srand(config->seed);
+    ilist_init(&balls);
+    if (!object_reservepool(step->balls)) {
+        fprintf(stderr, "Failed to reserve %d ball objects.\n", step->balls);
+        return 0;
+    }
+
+    physics.gravity = config->gravity;
+    physics.air = config->air;
+    physics.bounce = config->bounce;
+    physics.restspeed = config->restspeed;
+    physics.width = surface->w;
+    physics.height = surface->h;
+
+    context.frame = arena_create(256 * 1024);
+    if (!context.frame) {
+        fprintf(stderr, "Failed to create frame arena.\n");
+        return 0;
+    }
+    context.rasterizer = config->rasterizer;
+    context.stats = NULL;
+    context.lodpixels = config->lodpixels;
+    context.lodhysteresis = config->lodhysteresis;
+    context.impostorpixels = config->impostor;
+
+    start = SDL_GetPerformanceCounter();
+    for (created = 0; created < step->balls; created++) {
+        object_t *ball = create_object(surface, model);
+
+        if (!ball) {
+            fprintf(stderr, "Failed to create ball %d\n", created);
+            break;
+        }
+        physics_launch(ball, surface->w, surface->h);
+        ilist_addlast(&balls, &ball->link);
+    }
+    if (created == 0) {
+        arena_destroy(context.frame);
+        return 0;
+    }
+    step->balls = created;
+    step->spawn = (double)(SDL_GetPerformanceCounter() - start) * tickms * 1000.0 / created;
+
+    for (frame = -STRESS_WARMUP; frame < STRESS_FRAMES; frame++) {
+        start = SDL_GetPerformanceCounter();
+        workers_run(workers, object_count(), physics_stepslice, &physics);
+        mid = SDL_GetPerformanceCounter();
+
+        /* The last warm-up frame is rendered to grow the arena and warm the caches */
+        if (renderframes > 0 && frame >= -1 && frame < renderframes) {
+            arena_reset(context.frame);
+            SDL_FillRect(surface, NULL, 0x00000000);
+            ilist_foreach(&balls, link) {
+                draw_object(ilist_entry(link, object_t, link), &context);
+            }
+        }
+        end = SDL_GetPerformanceCounter();
+
+        if (frame >= 0) {
+            physicstimes[frame] = (double)(mid - start) * tickms;
+            rendertimes[frame] = (double)(end - mid) * tickms;
+            frametimes[frame] = (double)(end - start) * tickms;
+        }
+    }
+    step->physics = median(physicstimes, STRESS_FRAMES);
+    step->render = renderframes > 0 ? median(rendertimes, renderframes) : -1.0;
+    step->frame = renderframes > 0 ? median(frametimes, renderframes) : -1.0;
+    step->frames = renderframes;
+
+    start = SDL_GetPerformanceCounter();
+    ilist_foreach_safe(&balls, link, tmp) {
+        object_t *ball = ilist_entry(link, object_t, link);
+
+        ilist_remove(&balls, &ball->link);
+        destroy_object(ball);
+    }
+    step->expire = (double)(SDL_GetPerformanceCounter() - start) * tickms * 1000.0 / created;
+
+    arena_destroy(context.frame);
+
+    return 1;
+}
+
+/* Print the table row of a step, given the step before it at the same size or NULL. */
+static void print_step(FILE *file, const stressstep_t *step, const stressstep_t *prev)
+{
+    fprintf(file, "%5dx%-5d %7d %9.3f %10.3f %6d ", step->width, step->height, step->balls,
+            step->spawn, step->physics, step->frames);
+    print_time(file, "%10.3f ", "         - ", step->render);
+    print_time(file, "%10.3f ", "         - ", step->frame);
+    fprintf(file, "%9.3f ", step->expire);
+    print_slope(file, "%6.2f ", "     - ", prev ? prev->physics : 0.0, prev ? prev->balls : 1,
+                step->physics, step->balls);
+    print_slope(file, "%6.2f\n", "     -\n", prev ? prev->render : 0.0, prev ? prev->balls : 1,
+                step->render, step->balls);
+}
+
+/* Write the CSV row of a step; unmeasured values are left empty. */
+static void write_step(FILE *file, const stressstep_t *step, const stressstep_t *prev)
+{
+    fprintf(file, "%d,%d,%d,%.3f,%.4f,%d,", step->width, step->height, step->balls,
+            step->spawn, step->physics, step->frames);
+    print_time(file, "%.4f,", ",", step->render);
+    print_time(file, "%.4f,", ",", step->frame);
+    fprintf(file, "%.3f,", step->expire);
+    print_slope(file, "%.3f,", ",", prev ? prev->physics : 0.0, prev ? prev->balls : 1,
+                step->physics, step->balls);
+    print_slope(file, "%.3f\n", "\n", prev ? prev->render : 0.0, prev ? prev->balls : 1,
+                step->render, step->balls);
+}
+
+/* Run the stress ramp. */
+int stress_run(const config_t *config)
+{
+    stressstep_t step, prev;
+    int haveprev;
+    workers_t *workers;
+    model_t *model;
+    FILE *csv;
+
+    model = model_load(config->model);
+    if (!model) {
+        fprintf(stderr, "Failed to load %s; run make to generate it.\n", config->model);
+        return 0;
+    }
+    workers = workers_create(config->threads);
+    if (!workers) {
+        fprintf(stderr, "Failed to create %d worker threads.\n", config->threads);
+        model_destroy(model);
+        return 0;
+    }
+    csv = fopen(config->stress, "w");
+    if (!csv) {
+        fprintf(stderr, "Unable to create %s\n", config->stress);
+        workers_destroy(workers);
+        model_destroy(model);
+        return 0;
+    }
+
+    fprintf(csv, "width,height,balls,spawn_us,physics_ms,frames,render_ms,frame_ms,expire_us,"
+            "physics_slope,render_slope\n");
+    printf("Stress: median of up to %d frames after %d warm-up frames, %d threads; "
+           "%g s of rendering per step\n",
+           STRESS_FRAMES, STRESS_WARMUP, workers_count(workers), config->stressbudget);
+    printf("%-11s %7s %9s %10s %6s %10s %10s %9s %6s %6s\n", "size", "balls", "spawn us",
+           "physics ms", "frames", "render ms", "frame ms", "expire us", "phys^", "rend^");
+
+    for (int s = 0; s < NUM_SIZES; s++) {
+        backend_t *backend = backend_create(BACKEND_HEADLESS, sizes[s][0], sizes[s][1], NULL);
+
+        if (!backend) {
+            fclose(csv);
+            destroy_all_objects();
+            workers_destroy(workers);
+            model_destroy(model);
+            return 0;
+        }
+
+        /* Slopes and budgets compare with the last step measured at this size */
+        haveprev = 0;
+        for (int c = 0; c < NUM_COUNTS; c++) {
+            int renderframes = render_frames(config, haveprev ? &prev : NULL, counts[c]);
+
+            step.width = sizes[s][0];
+            step.height = sizes[s][1];
+            step.balls = counts[c];
+            if (!run_step(backend_surface(backend), model, workers, config, renderframes, &step)) {
+                fprintf(stderr, "Skipping %d balls at %dx%d.\n", counts[c], step.width, step.height);
+                continue;
+            }
+
+            print_step(stdout, &step, haveprev ? &prev : NULL);
+            write_step(csv, &step, haveprev ? &prev : NULL);
+            fflush(stdout);
+            prev = step;
+            haveprev = 1;
+        }
+
+        backend_destroy(backend);
+    }
+
+    /* Give back the object pool the largest steps grew */
+    destroy_all_objects();
+    workers_destroy(workers);
+    model_destroy(model);
+    if (fclose(csv) != 0) {
+        fprintf(stderr, "Unable to write %s\n", config->stress);
+        return 0;
+    }
+    printf("Stress table written to %s\n", config->stress);
+
+    return 1;
+}
@@ -0,0 +1,40 @@
+#ifndef STRESS_H_
+#define STRESS_H_
+
+#include "config.h"
+
+/*
+ * Stress mode interface
+ *
+ * Measures how frame time grows with the number of balls and the surface
+ * size. For each surface size in STRESS_SIZES the ball count is ramped
+ * through STRESS_COUNTS on a headless backend. Each step spawns the balls,
+ * runs STRESS_WARMUP frames so the balls settle into steady state, then
+ * times up to STRESS_FRAMES frames and takes the median physics and render
+ * (clear and draw) time. Only the last warm-up frame is rendered. Balls
+ * never expire during a step, so the count stays fixed. Spawning and
+ * removing the balls are timed as well, which covers the ball list and
+ * object store.
+ *
+ * The slope column is the scaling exponent since the previous ball count:
+ * log(time ratio) / log(count ratio). About 1 is linear, clearly above 1
+ * is superlinear. The previous step's render time, scaled linearly to the
+ * new count, predicts the cost of a rendered frame. A step renders as many
+ * frames as fit in config->stressbudget seconds, up to STRESS_FRAMES, and
+ * is not rendered at all if fewer than STRESS_MINFRAMES fit, so large
+ * steps cannot run for hours; physics is still timed over STRESS_FRAMES.
+ */
+
+/* Frames run before timing, and the most and fewest frames timed, per step */
+#define STRESS_WARMUP       5
+#define STRESS_FRAMES       20
+#define STRESS_MINFRAMES    3
+
+/*
+ * Run the stress ramp with the physics, model, threads, rasterizer, seed
+ * and render budget in config. Prints the scaling table to stdout and
+ * writes it as CSV to config->stress. Returns 1 on success, 0 on error.
+ */
+int stress_run(const config_t *config);
+
+#endif /*STRESS_H_*/
@@ -0,0 +1,227 @@
+/*
+ * Hierarchical timer wheel with millisecond ticks and cascading levels.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "timerwheel.h"
+
+#define WHEEL_BITS      6
+#define WHEEL_SIZE      (1 << WHEEL_BITS)
+#define WHEEL_MASK      (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS    4
+#define WHEEL_SPAN      (1u << (WHEEL_BITS * WHEEL_LEVELS))
+
+struct timerwheel {
+    wheeltimer_t    *slots[WHEEL_LEVELS][WHEEL_SIZE];
+    wheeltimer_t    *expired;       /* Due timers not yet handed out */
+    unsigned int    current;        /* Next tick to be processed */
+    int             numtimers;      /* Pending timers, including expired ones */
+};
+
+/* Push timer onto the list starting at head. */
+static void link_timer(wheeltimer_t **head, wheeltimer_t *timer)
+{
+    timer->next = *head;
+    if (*head) {
+        (*head)->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+}
+
+/* Take timer out of whatever list it is in. */
+static void unlink_timer(wheeltimer_t *timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/* Put timer in the coarsest slot that still separates it from the current tick. */
+static void place_timer(timerwheel_t *wheel, wheeltimer_t *timer)
+{
+    unsigned int expires = timer->expires;
+    unsigned int delta = expires - wheel->current;
+    int level = 0;
+
+    if ((int)delta < 0) {
+        /* Already due; fire on the next tick. */
+        expires = wheel->current;
+        delta = 0;
+    } else if (delta >= WHEEL_SPAN) {
+        /* Too far out; park in the last slot and re-place when it comes round. */
+        expires = wheel->current + WHEEL_SPAN - 1;
+        delta = WHEEL_SPAN - 1;
+    }
+
+    while (delta >= (1u << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    link_timer(&wheel->slots[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK], timer);
+}
+
+/* Re-place every timer in one slot of a coarser level as its time draws near. */
+static void cascade(timerwheel_t *wheel, int level, int index)
+{
+    wheeltimer_t *timer;
+
+    while ((timer = wheel->slots[level][index]) != NULL) {
+        unlink_timer(timer);
+        place_timer(wheel, timer);
+    }
+}
+
+/* Process the current tick: cascade coarser levels, then collect the due slot. */
+static void tick(timerwheel_t *wheel)
+{
+    wheeltimer_t *timer;
+    unsigned int current = wheel->current;
+    int level;
+
+    for (level = 1; level < WHEEL_LEVELS; level++) {
+        if ((current >> (WHEEL_BITS * (level - 1))) & WHEEL_MASK) {
+            break;
+        }
+        cascade(wheel, level, (current >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    }
+
+    while ((timer = wheel->slots[0][current & WHEEL_MASK]) != NULL) {
+        unlink_timer(timer);
+        if ((int)(timer->expires - current) > 0) {
+            /* Parked beyond the wheel span; not actually due yet. */
+            place_timer(wheel, timer);
+        } else {
+            link_timer(&wheel->expired, timer);
+        }
+    }
+
+    wheel->current = current + 1;
+}
+
+/* Return a newly created, empty timer wheel whose clock starts at now. */
+timerwheel_t *timerwheel_create(unsigned int now)
+{
+    timerwheel_t *wheel = malloc(sizeof(*wheel));
+
+    if (!wheel) {
+        return NULL;
+    }
+
+    memset(wheel->slots, 0, sizeof(wheel->slots));
+    wheel->expired = NULL;
+    wheel->current = now;
+    wheel->numtimers = 0;
+
+    return wheel;
+}
+
+/* Detach every timer in the list so it reads as idle. */
+static void detach_all(wheeltimer_t **head)
+{
+    wheeltimer_t *timer;
+
+    while ((timer = *head) != NULL) {
+        unlink_timer(timer);
+        timer->wheel = NULL;
+    }
+}
+
+/* Free the wheel, leaving its timers idle. */
+void timerwheel_destroy(timerwheel_t *wheel)
+{
+    int level, index;
+
+    if (!wheel) {
+        return;
+    }
+
+    for (level = 0; level < WHEEL_LEVELS; level++) {
+        for (index = 0; index < WHEEL_SIZE; index++) {
+            detach_all(&wheel->slots[level][index]);
+        }
+    }
+    detach_all(&wheel->expired);
+
+    free(wheel);
+}
+
+/* Prepare a timer for use. */
+void wheeltimer_init(wheeltimer_t *timer)
+{
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->wheel = NULL;
+    timer->expires = 0;
+}
+
+/* Schedule timer at the absolute time expires. */
+void timerwheel_schedule(timerwheel_t *wheel, wheeltimer_t *timer, unsigned int expires)
+{
+    if (!wheel || !timer) {
+        return;
+    }
+
+    timerwheel_cancel(timer);
+
+    timer->expires = expires;
+    timer->wheel = wheel;
+    wheel->numtimers++;
+    place_timer(wheel, timer);
+}
+
+/* Cancel the timer if it is pending. */
+void timerwheel_cancel(wheeltimer_t *timer)
+{
+    if (!timer || !timer->pprev) {
+        return;
+    }
+
+    unlink_timer(timer);
+    timer->wheel->numtimers--;
+    timer->wheel = NULL;
+}
+
+/* Return 1 if the timer is pending. */
+int timerwheel_pending(wheeltimer_t *timer)
+{
+    return timer && timer->pprev != NULL;
+}
+
+/* Advance the wheel clock to now and return one due timer, or NULL. */
+wheeltimer_t *timerwheel_expire(timerwheel_t *wheel, unsigned int now)
+{
+    wheeltimer_t *timer;
+
+    if (!wheel) {
+        return NULL;
+    }
+
+    while (!wheel->expired) {
+        if ((int)(now - wheel->current) < 0) {
+            return NULL;
+        }
+        if (wheel->numtimers == 0) {
+            /* Nothing pending; skip the idle ticks entirely. */
+            wheel->current = now + 1;
+            return NULL;
+        }
+        tick(wheel);
+    }
+
+    timer = wheel->expired;
+    unlink_timer(timer);
+    timer->wheel = NULL;
+    wheel->numtimers--;
+
+    return timer;
+}
+
+/* Return the number of pending timers. */
+int timerwheel_size(timerwheel_t *wheel)
+{
+    return wheel ? wheel->numtimers : 0;
+}
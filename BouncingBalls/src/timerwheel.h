@@ -0,0 +1,75 @@
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include <stddef.h>
+
+/*
+ * Hierarchical timer wheel interface
+ *
+ * Timers are embedded in the objects they belong to and are scheduled at an
+ * absolute time in milliseconds (as returned by SDL_GetTicks). The wheel has
+ * four levels of 64 slots; a timer sits in the coarsest slot that still
+ * separates it from the present and trickles down as time approaches. The
+ * cost of advancing the wheel depends on elapsed time and the number of
+ * timers that expire, not on how many timers are pending.
+ */
+
+typedef struct timerwheel timerwheel_t;
+typedef struct wheeltimer wheeltimer_t;
+
+struct wheeltimer {
+    wheeltimer_t    *next;
+    wheeltimer_t    **pprev;    /* Link pointing at this timer, NULL when idle */
+    timerwheel_t    *wheel;     /* Wheel the timer is scheduled in */
+    unsigned int    expires;    /* Absolute expiry time in ms */
+};
+
+/*
+ * Return the item of the given type that embeds timer as its member field.
+ */
+#define wheeltimer_entry(timer, type, member) \
+    ((type *)((char *)(timer) - offsetof(type, member)))
+
+/*
+ * Return a newly created, empty timer wheel whose clock starts at now.
+ */
+timerwheel_t *timerwheel_create(unsigned int now);
+
+/*
+ * Free the wheel. Timers still scheduled are left idle, not expired.
+ */
+void timerwheel_destroy(timerwheel_t *wheel);
+
+/*
+ * Prepare a timer for use. Must be called before the timer is scheduled.
+ */
+void wheeltimer_init(wheeltimer_t *timer);
+
+/*
+ * Schedule timer to expire at the absolute time expires, rescheduling it if
+ * it is already pending. Times in the past expire on the next advance.
+ */
+void timerwheel_schedule(timerwheel_t *wheel, wheeltimer_t *timer, unsigned int expires);
+
+/*
+ * Cancel the timer if it is pending; does nothing otherwise.
+ */
+void timerwheel_cancel(wheeltimer_t *timer);
+
+/*
+ * Return 1 if the timer is scheduled and has not yet been returned as expired.
+ */
+int timerwheel_pending(wheeltimer_t *timer);
+
+/*
+ * Advance the wheel clock to now and return one timer that is due, or NULL
+ * when no more timers are due. Call repeatedly until it returns NULL.
+ */
+wheeltimer_t *timerwheel_expire(timerwheel_t *wheel, unsigned int now);
+
+/*
+ * Return the number of pending timers.
+ */
+int timerwheel_size(timerwheel_t *wheel);
+
+#endif /*TIMERWHEEL_H_*/
@@ -0,0 +1,171 @@
+/*
+ * Trace module: per-thread event buffers and Chrome trace-event output.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "trace.h"
+
+typedef struct traceevent traceevent_t;
+
+struct traceevent {
+    const char  *name;
+    Uint64      start;  /* Performance-counter ticks */
+    Uint64      end;
+};
+
+typedef struct tracebuffer tracebuffer_t;
+
+/* Events of one thread; only that thread writes to it */
+struct tracebuffer {
+    char            threadname[32];
+    int             numevents;
+    long            dropped;    /* Events lost because the buffer was full */
+    traceevent_t    events[];
+};
+
+int trace_active = 0;
+
+static Uint64 tracestart;
+static SDL_atomic_t numbuffers;
+static tracebuffer_t *buffers[TRACE_MAXTHREADS];
+
+/* The calling thread's buffer, claimed on its first event */
+static __thread tracebuffer_t *threadbuffer;
+
+/* Return the calling thread's buffer, creating it if needed. */
+static tracebuffer_t *get_buffer(void)
+{
+    tracebuffer_t *buffer = threadbuffer;
+    int slot;
+
+    if (buffer) {
+        return buffer;
+    }
+
+    slot = SDL_AtomicAdd(&numbuffers, 1);
+    if (slot >= TRACE_MAXTHREADS) {
+        return NULL;
+    }
+
+    buffer = malloc(sizeof(*buffer) + sizeof(traceevent_t) * TRACE_MAXEVENTS);
+    if (!buffer) {
+        return NULL;
+    }
+    buffer->threadname[0] = '\0';
+    buffer->numevents = 0;
+    buffer->dropped = 0;
+
+    buffers[slot] = buffer;
+    threadbuffer = buffer;
+
+    return buffer;
+}
+
+/* Start tracing. */
+void trace_start(void)
+{
+    tracestart = SDL_GetPerformanceCounter();
+    trace_active = 1;
+}
+
+/* Record an event on the calling thread. */
+void trace_event(const char *name, Uint64 start, Uint64 end)
+{
+    tracebuffer_t *buffer = get_buffer();
+    traceevent_t *event;
+
+    if (!buffer) {
+        return;
+    }
+    if (buffer->numevents == TRACE_MAXEVENTS) {
+        buffer->dropped++;
+        return;
+    }
+
+    event = &buffer->events[buffer->numevents++];
+    event->name = name;
+    event->start = start;
+    event->end = end;
+}
+
+/* Name the calling thread's track. */
+void trace_threadname(const char *name)
+{
+    tracebuffer_t *buffer;
+
+    if (!trace_active) {
+        return;
+    }
+
+    buffer = get_buffer();
+    if (buffer) {
+        snprintf(buffer->threadname, sizeof(buffer->threadname), "%s", name);
+    }
+}
+
+/* Stop tracing, write the trace and free the buffers. */
+int trace_write(const char *path)
+{
+    int count = SDL_AtomicGet(&numbuffers);
+    double tickus = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+    long dropped = 0;
+    FILE *file;
+    int first = 1;
+    int i, k;
+
+    trace_active = 0;
+    if (count > TRACE_MAXTHREADS) {
+        count = TRACE_MAXTHREADS;
+    }
+
+    file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Unable to create trace file %s\n", path);
+    } else {
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        for (i = 0; i < count; i++) {
+            tracebuffer_t *buffer = buffers[i];
+
+            if (!buffer) {
+                continue;
+            }
+            if (buffer->threadname[0]) {
+                fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                        "\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", i, buffer->threadname);
+                first = 0;
+            }
+            for (k = 0; k < buffer->numevents; k++) {
+                traceevent_t *event = &buffer->events[k];
+
+                fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                        "\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n", event->name, i,
+                        (double)(event->start - tracestart) * tickus,
+                        (double)(event->end - event->start) * tickus);
+                first = 0;
+            }
+            dropped += buffer->dropped;
+        }
+        fprintf(file, "\n]}\n");
+        if (fclose(file) != 0) {
+            fprintf(stderr, "Unable to write trace file %s\n", path);
+            file = NULL;
+        }
+    }
+
+    if (dropped > 0) {
+        fprintf(stderr, "Trace buffers were full; %ld events dropped\n", dropped);
+    }
+
+    for (i = 0; i < count; i++) {
+        free(buffers[i]);
+        buffers[i] = NULL;
+    }
+    SDL_AtomicSet(&numbuffers, 0);
+
+    /* Only the caller's own buffer pointer can be reset; other threads are gone */
+    threadbuffer = NULL;
+
+    return file != NULL;
+}
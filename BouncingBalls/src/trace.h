@@ -0,0 +1,68 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <SDL2/SDL.h>
+
+/*
+ * Timeline tracing interface
+ *
+ * Scopes record complete events (name, start, duration) into a buffer
+ * owned by the thread that records them, so threads never contend or
+ * lock. Each buffer holds TRACE_MAXEVENTS events; once it is full further
+ * events are counted and dropped, which bounds both memory and overhead.
+ * trace_write saves every buffer as Chrome trace-event JSON, which
+ * Perfetto and chrome://tracing load, with one track per thread.
+ *
+ * While tracing is off a scope costs one test of trace_active. Building
+ * with -DNO_TRACE removes the scopes entirely. Event names must be
+ * string literals or otherwise outlive the trace.
+ */
+
+/* Events each thread can record */
+#define TRACE_MAXEVENTS     (1 << 18)
+
+/* Threads that can record */
+#define TRACE_MAXTHREADS    72
+
+#ifndef NO_TRACE
+/* Start timing a scope, storing the start time in a new variable var */
+#define TRACE_BEGIN(var) \
+    Uint64 var = trace_active ? SDL_GetPerformanceCounter() : 0
+/* Record the scope started by TRACE_BEGIN(var) as an event called name */
+#define TRACE_END(name, var) \
+    do { \
+        if (trace_active) \
+            trace_event(name, var, SDL_GetPerformanceCounter()); \
+    } while (0)
+#else
+#define TRACE_BEGIN(var)
+#define TRACE_END(name, var)
+#endif
+
+/* Nonzero while tracing; tested by the scope macros */
+extern int trace_active;
+
+/*
+ * Start tracing. Call before starting the threads to be traced.
+ */
+void trace_start(void);
+
+/*
+ * Record an event called name from start to end, in performance-counter
+ * ticks, on the calling thread.
+ */
+void trace_event(const char *name, Uint64 start, Uint64 end);
+
+/*
+ * Name the calling thread's track in the trace.
+ */
+void trace_threadname(const char *name);
+
+/*
+ * Stop tracing, write the trace as Chrome trace-event JSON to path and
+ * free the buffers. Every traced thread other than the caller must have
+ * finished. Returns 1 on success, 0 on failure.
+ */
+int trace_write(const char *path);
+
+#endif /*TRACE_H_*/
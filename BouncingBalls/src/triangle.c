@@ -1,9 +1,11 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 #include <math.h>
 #include <SDL2/SDL.h>
 #include "triangle.h"
 #include "drawline.h"
+#include "profile.h"
 
 #define MIN(x,y)    (x < y ? x : y)
 #define MIN3(x,y,z) MIN(MIN(x,y), MIN(x,z))
@@ -13,21 +15,21 @@
 #define TRIANGLE_PENCOLOR   0xBBBB0000
 
 /* 
- * Print triangle coordinates along with a message
+ * Print on-screen triangle coordinates along with a message
  */
-void print_triangle(triangle_t *triangle, char *msg)
+static void print_triangle(screentri_t *triangle, char *msg)
 {
     printf("%s: %d,%d - %d,%d - %d,%d\n",
         msg,
-        triangle->x1, triangle->y1, 
-        triangle->x2, triangle->y2, 
-        triangle->x3, triangle->y3);
+        triangle->sx1, triangle->sy1, 
+        triangle->sx2, triangle->sy2, 
+        triangle->sx3, triangle->sy3);
 }
 
 /*
  * Return 0 if triangle coordinates are outside the surface boundary. 1 otherwise.
  */
-int sanity_check_triangle(SDL_Surface *surface, triangle_t *triangle)
+static int sanity_check_triangle(SDL_Surface *surface, screentri_t *triangle)
 {
     if (triangle->sx1 < 0 || triangle->sx1 >= surface->w ||
         triangle->sx2 < 0 || triangle->sx2 >= surface->w ||
@@ -42,39 +44,40 @@ int sanity_check_triangle(SDL_Surface *surface, triangle_t *triangle)
 }
 
 /*
- * Scale triangle, altering the on-screen coordinates(e.g. triangle->sx1)
+ * Scale the model corners, setting the on-screen coordinates(e.g. triangle->sx1)
  */
-void scale_triangle(triangle_t *triangle)
+static void scale_triangle(screentri_t *triangle, float scale,
+                           int x1, int y1, int x2, int y2, int x3, int y3)
 {
     /* Scale triangle */
-    triangle->sx1 = (int)((float)triangle->x1*triangle->scale);
-    triangle->sx2 = (int)((float)triangle->x2*triangle->scale);
-    triangle->sx3 = (int)((float)triangle->x3*triangle->scale);
-    triangle->sy1 = (int)((float)triangle->y1*triangle->scale);
-    triangle->sy2 = (int)((float)triangle->y2*triangle->scale);
-    triangle->sy3 = (int)((float)triangle->y3*triangle->scale);
+    triangle->sx1 = (int)((float)x1*scale);
+    triangle->sx2 = (int)((float)x2*scale);
+    triangle->sx3 = (int)((float)x3*scale);
+    triangle->sy1 = (int)((float)y1*scale);
+    triangle->sy2 = (int)((float)y2*scale);
+    triangle->sy3 = (int)((float)y3*scale);
 }
 
 /*
- * Move the triangle to the center of the surface,
+ * Move the triangle to its on-screen position,
  * altering the on-screen coordinates(e.g. triangle->sx1)
  */
-void translate_triangle(triangle_t *triangle)
+static void translate_triangle(screentri_t *triangle, int tx, int ty)
 {
-    triangle->sx1 += triangle->tx;
-    triangle->sx2 += triangle->tx;
-    triangle->sx3 += triangle->tx;
+    triangle->sx1 += tx;
+    triangle->sx2 += tx;
+    triangle->sx3 += tx;
     
-    triangle->sy1 += triangle->ty;
-    triangle->sy2 += triangle->ty;
-    triangle->sy3 += triangle->ty;
+    triangle->sy1 += ty;
+    triangle->sy2 += ty;
+    triangle->sy3 += ty;
 }
 
 /*
  * Calculate the triangle bounding box,
  * altering fields of the triangle's rect(e.g. triangle->rect.x)
  */
-void calculate_triangle_bounding_box(triangle_t *triangle)
+static void calculate_triangle_bounding_box(screentri_t *triangle)
 {
     /* Calculate upper left corner of bounding box */
     triangle->rect.x = MIN3(triangle->sx1, triangle->sx2, triangle->sx3);
@@ -88,7 +91,7 @@ void calculate_triangle_bounding_box(triangle_t *triangle)
 /*
  * Fill the triangle on the surface with the triangle's color
  */
-void fill_triangle(SDL_Surface *surface, triangle_t *triangle)
+static void fill_triangle(SDL_Surface *surface, screentri_t *triangle, renderstats_t *stats)
 {
     int x, y;
     int startfill, stopfill;
@@ -114,6 +117,9 @@ void fill_triangle(SDL_Surface *surface, triangle_t *triangle)
         if (startfill != -1) {
             if (stopfill == -1)             /* might be only a single pixel set */
                 stopfill = startfill;
+            if (stats)
+                renderstats_span(stats, triangle->rect.x + startfill,
+                                 triangle->rect.x + stopfill, triangle->rect.y + y);
             while (startfill <= stopfill) {
                 set_pixel(surface, triangle->rect.x + startfill, triangle->rect.y + y, triangle->fillcolor);
                 startfill++;
@@ -123,26 +129,13 @@ void fill_triangle(SDL_Surface *surface, triangle_t *triangle)
 }
 
 /*
- * Rotate the triangle given based on it's rotation field
+ * Rotate the triangle by the given rotation matrix
  */
-void rotate_triangle(triangle_t *triangle)
+static void rotate_triangle(screentri_t *triangle, const float matrix[2][2])
 {
-    static float rotation = 0;
-    static float sinr = 0, cosr = 1;
     float sx1, sx2, sx3;
     float sy1, sy2, sy3;
 
-    /* 
-     * Cache sin and cos calculations to reduce overhead
-     * INFO: Local variables that are declared static persist across function calls.
-     */
-    if (triangle->rotation != rotation) {
-        rotation = triangle->rotation;
-        sinr = sinf(rotation*M_PI/180.0);
-        cosr = cosf(rotation*M_PI/180.0);
-    }
-
-
     /* Copy original coordinates */
     sx1 = (float)triangle->sx1;
     sx2 = (float)triangle->sx2;
@@ -152,54 +145,257 @@ void rotate_triangle(triangle_t *triangle)
     sy3 = (float)triangle->sy3;
 
     /* Rotate */
-    triangle->sx1 = (int)(sx1*cosr - sy1*sinr);
-    triangle->sx2 = (int)(sx2*cosr - sy2*sinr);
-    triangle->sx3 = (int)(sx3*cosr - sy3*sinr);
-    triangle->sy1 = (int)(sx1*sinr + sy1*cosr);
-    triangle->sy2 = (int)(sx2*sinr + sy2*cosr);
-    triangle->sy3 = (int)(sx3*sinr + sy3*cosr);
+    triangle->sx1 = (int)(sx1*matrix[0][0] + sy1*matrix[0][1]);
+    triangle->sx2 = (int)(sx2*matrix[0][0] + sy2*matrix[0][1]);
+    triangle->sx3 = (int)(sx3*matrix[0][0] + sy3*matrix[0][1]);
+    triangle->sy1 = (int)(sx1*matrix[1][0] + sy1*matrix[1][1]);
+    triangle->sy2 = (int)(sx2*matrix[1][0] + sy2*matrix[1][1]);
+    triangle->sy3 = (int)(sx3*matrix[1][0] + sy3*matrix[1][1]);
+}
+
+/*
+ * Set the transform's rotation matrix to turn by the given number of degrees
+ */
+void transform_setrotation(transform_t *transform, float degrees)
+{
+    float sinr = sinf(degrees*M_PI/180.0);
+    float cosr = cosf(degrees*M_PI/180.0);
+
+    transform->matrix[0][0] = cosr;
+    transform->matrix[0][1] = -sinr;
+    transform->matrix[1][0] = sinr;
+    transform->matrix[1][1] = cosr;
+}
+
+/*
+ * Transform a model triangle to screen space: scale, rotate, translate, bound,
+ * and decode its palette color
+ */
+void transform_triangle(const modeltri_t *triangle, const transform_t *transform, screentri_t *out)
+{
+    scale_triangle(out, transform->scale,
+                   triangle->x1, triangle->y1,
+                   triangle->x2, triangle->y2,
+                   triangle->x3, triangle->y3);
+    rotate_triangle(out, transform->matrix);
+    translate_triangle(out, transform->tx, transform->ty);
+    calculate_triangle_bounding_box(out);
+    out->fillcolor = transform->palette[triangle->color];
+}
+
+/*
+ * Draw the three edges of a screen-space triangle in the given color
+ */
+static void outline_triangle(SDL_Surface *surface, screentri_t *triangle, Uint32 pencolor,
+                             renderstats_t *stats)
+{
+    PROFILE_BEGIN(lines);
+    draw_countedline(surface, 
+             triangle->sx1, triangle->sy1,
+             triangle->sx2, triangle->sy2,
+             pencolor, stats);
+    draw_countedline(surface, 
+             triangle->sx2, triangle->sy2,
+             triangle->sx3, triangle->sy3,
+             pencolor, stats);
+    draw_countedline(surface, 
+             triangle->sx3, triangle->sy3,
+             triangle->sx1, triangle->sy1,
+             pencolor, stats);
+    PROFILE_END(PROFILE_LINES, lines);
+}
+
+/*
+ * Draw a filled screen-space triangle that lies on the surface
+ */
+void fill_screentriangle(SDL_Surface *surface, screentri_t *triangle, renderstats_t *stats)
+{
+    if (stats) {
+        stats->drawn++;
+    }
+
+    /* Outline in the pen color that fill_triangle scans for, then fill */
+    outline_triangle(surface, triangle, TRIANGLE_PENCOLOR, stats);
+    PROFILE_BEGIN(fill);
+    fill_triangle(surface, triangle, stats);
+    PROFILE_END(PROFILE_FILL, fill);
+}
+
+/*
+ * Draw the outline of a screen-space triangle that lies on the surface
+ */
+void wire_screentriangle(SDL_Surface *surface, screentri_t *triangle, renderstats_t *stats)
+{
+    if (stats) {
+        stats->drawn++;
+    }
+
+    /* A wireframe keeps its outline, so draw it in the triangle's own color */
+    outline_triangle(surface, triangle, triangle->fillcolor, stats);
+}
+
+/*
+ * Return a / b rounded up, for b > 0
+ */
+static long long ceil_div(long long a, long long b)
+{
+    return a >= 0 ? (a + b - 1) / b : a / b;
 }
 
 /*
- * Draw a filled triangle on the given surface
+ * Find the pixels draw_line would set on row y for the line from (x1, y1)
+ * to (x2, y2), without walking the line. Return 0 if it has none, and 1
+ * with the leftmost and rightmost of them in left and right otherwise.
+ */
+static int line_row(int x1, int y1, int x2, int y2, int y, int *left, int *right)
+{
+    long long dx = llabs((long long)x2 - x1), sx = x2 < x1 ? -1 : 1;
+    long long dy = llabs((long long)y2 - y1), sy = y2 < y1 ? -1 : 1;
+    long long j = ((long long)y - y1) * sy;     /* Steps along y from the start */
+    long long first, last;
+
+    if (j < 0 || j > dy) {
+        return 0;
+    }
+
+    if (dx > dy) {
+        /* Stepping along x, the line moves to row j halfway between minor steps */
+        if (dy == 0) {
+            first = 0;
+            last = dx;
+        } else {
+            first = ceil_div((2 * j - 1) * dx, 2 * dy);
+            last = ceil_div((2 * j + 1) * dx, 2 * dy) - 1;
+            first = first < 0 ? 0 : first;
+            last = last > dx ? dx : last;
+        }
+    } else {
+        /* Stepping along y, one pixel per row, rounded away from the start */
+        first = last = dy == 0 ? 0 : (2 * dx * j + dy) / (2 * dy);
+    }
+
+    first = x1 + sx * first;
+    last = x1 + sx * last;
+    *left = (int)(first < last ? first : last);
+    *right = (int)(first < last ? last : first);
+
+    return 1;
+}
+
+/*
+ * Draw a screen-space triangle that may reach past the surface edges,
+ * clipped to the surface
+ */
+void draw_clippedtriangle(SDL_Surface *surface, screentri_t *triangle, int rasterizer,
+                          renderstats_t *stats)
+{
+    const int xs[3] = { triangle->sx1, triangle->sx2, triangle->sx3 };
+    const int ys[3] = { triangle->sy1, triangle->sy2, triangle->sy3 };
+    Uint32 *pixels = surface->pixels;
+    int ystart, yend, x, y, e;
+
+    if (sanity_check_triangle(surface, triangle)) {
+        if (rasterizer == TRIANGLE_WIREFRAME) {
+            wire_screentriangle(surface, triangle, stats);
+        } else {
+            fill_screentriangle(surface, triangle, stats);
+        }
+        return;
+    }
+    if (triangle->rect.x >= surface->w || triangle->rect.x + triangle->rect.w <= 0 ||
+        triangle->rect.y >= surface->h || triangle->rect.y + triangle->rect.h <= 0) {
+        if (stats)
+            stats->culled++;
+        return;
+    }
+    if (stats) {
+        stats->clipped++;
+        stats->drawn++;
+    }
+
+    ystart = MAX(triangle->rect.y, 0);
+    yend = MIN(triangle->rect.y + triangle->rect.h - 1, surface->h - 1);
+
+    /*
+     * Work out each row's edge pixels directly, so rows and edge pixels
+     * off the surface cost nothing. A filled row covers the leftmost to the
+     * rightmost edge pixel, as fill_triangle does with the drawn outline.
+     */
+    PROFILE_BEGIN(clip);
+    for (y = ystart; y <= yend; y++) {
+        Uint32 *row = pixels + y * surface->w;
+        int left = INT_MAX, right = INT_MIN;
+        int l, r;
+
+        for (e = 0; e < 3; e++) {
+            if (!line_row(xs[e], ys[e], xs[(e + 1) % 3], ys[(e + 1) % 3], y, &l, &r)) {
+                continue;
+            }
+            left = MIN(left, l);
+            right = MAX(right, r);
+
+            if (rasterizer == TRIANGLE_WIREFRAME) {
+                l = MAX(l, 0);
+                r = MIN(r, surface->w - 1);
+                for (x = l; x <= r; x++) {
+                    row[x] = triangle->fillcolor;
+                }
+                if (stats && l <= r)
+                    renderstats_span(stats, l, r, y);
+            }
+        }
+
+        if (rasterizer == TRIANGLE_FILLED && left <= right) {
+            left = MAX(left, 0);
+            right = MIN(right, surface->w - 1);
+            for (x = left; x <= right; x++) {
+                row[x] = triangle->fillcolor;
+            }
+            if (stats && left <= right)
+                renderstats_span(stats, left, right, y);
+        }
+    }
+    PROFILE_END(rasterizer == TRIANGLE_FILLED ? PROFILE_FILL : PROFILE_LINES, clip);
+}
+
+/*
+ * Draw a filled triangle on the given surface,
+ * leaving its on-screen coordinates and bounding box in the triangle
  */
 void draw_triangle(SDL_Surface *surface, triangle_t *triangle)
 {
-    int isOK;
-    
+    transform_t transform;
+    screentri_t screen;
+
     /* Scale. */
-    scale_triangle(triangle);
+    scale_triangle(&screen, triangle->scale,
+                   triangle->x1, triangle->y1,
+                   triangle->x2, triangle->y2,
+                   triangle->x3, triangle->y3);
 
     /* Rotate triangle */
-    rotate_triangle(triangle);
+    transform_setrotation(&transform, triangle->rotation);
+    rotate_triangle(&screen, transform.matrix);
     
     /* Translate. */
-    translate_triangle(triangle);
+    translate_triangle(&screen, triangle->tx, triangle->ty);
     
     /* Determine bounding box */
-    calculate_triangle_bounding_box(triangle);
+    calculate_triangle_bounding_box(&screen);
+    screen.fillcolor = triangle->fillcolor;
+
+    triangle->sx1 = screen.sx1;
+    triangle->sy1 = screen.sy1;
+    triangle->sx2 = screen.sx2;
+    triangle->sy2 = screen.sy2;
+    triangle->sx3 = screen.sx3;
+    triangle->sy3 = screen.sy3;
+    triangle->rect = screen.rect;
 
     /* Sanity check that triangle is within surface boundaries. */
-    isOK = sanity_check_triangle(surface, triangle);
-    if (!isOK) {
-        print_triangle(triangle, "Triangle outside surface boundaries");
+    if (!sanity_check_triangle(surface, &screen)) {
+        print_triangle(&screen, "Triangle outside surface boundaries");
         return;
     }
-
-    /* Draw triangle */
-    draw_line(surface, 
-             triangle->sx1, triangle->sy1,
-             triangle->sx2, triangle->sy2,
-             TRIANGLE_PENCOLOR);
-    draw_line(surface, 
-             triangle->sx2, triangle->sy2,
-             triangle->sx3, triangle->sy3,
-             TRIANGLE_PENCOLOR);
-    draw_line(surface, 
-             triangle->sx3, triangle->sy3,
-             triangle->sx1, triangle->sy1,
-             TRIANGLE_PENCOLOR);
-
-    /* Fill triangle */
-    fill_triangle(surface, triangle);
+    fill_screentriangle(surface, &screen, NULL);
 }
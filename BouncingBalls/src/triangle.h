@@ -2,13 +2,23 @@
 #define TRIANGLE_H_
 
 #include <SDL2/SDL.h>
+#include "renderstats.h"
 
 #ifndef M_PI
 #define M_PI (3.14159265358979323846)
 #endif
 
+/* Triangle rasterizers */
+#define TRIANGLE_FILLED     0   /* Outline, then flood fill the interior */
+#define TRIANGLE_WIREFRAME  1   /* Outline only, in the fill color */
+
 typedef struct triangle triangle_t;
 
+/*
+ * Self-contained triangle with both its model data and per-draw state.
+ * This is the format of the generated model headers; the object pipeline
+ * uses the split modeltri_t/screentri_t layout below instead.
+ */
 struct triangle {
     /* Model coordinates, where each pair resemble a corner  */
     int x1, y1;
@@ -17,7 +27,7 @@ struct triangle {
 
     /* The color the triangle is to be filled with */
     unsigned int fillcolor;
-    
+
     /* Scale factor, meaning 0.5 should half the size, 1 keep, and 2.0 double */
     float scale;
 
@@ -26,8 +36,8 @@ struct triangle {
 
     /* The degrees the triangle is supposed to be rotated at the current frame */
     float rotation;
-    
-    /* 
+
+    /*
      * Bounding box of on-screen coordinates:
      * rect.x - x-coordinate of the bounding box' top left corner
      * rect.y - y-coordinate of the bounding box' top left corner
@@ -42,8 +52,92 @@ struct triangle {
     int sx3, sy3;
 };
 
+typedef struct modeltri modeltri_t;
+
+/*
+ * Immutable model triangle, packed to 14 bytes. The fill color is an index
+ * into the model's palette and is only resolved in the transform stage.
+ */
+struct modeltri {
+    /* Model coordinates, where each pair resemble a corner */
+    Sint16 x1, y1;
+    Sint16 x2, y2;
+    Sint16 x3, y3;
+
+    /* Palette index of the color the triangle is to be filled with */
+    Uint8 color;
+
+    /* Unused; keeps the size explicit */
+    Uint8 pad;
+};
+
+typedef struct screentri screentri_t;
+
+/*
+ * Transient screen-space triangle written by the transform stage.
+ */
+struct screentri {
+    /* On-screen coordinates, where each pair resemble a corner */
+    int sx1, sy1;
+    int sx2, sy2;
+    int sx3, sy3;
+
+    /* Bounding box of the on-screen coordinates */
+    SDL_Rect rect;
+
+    /* The color the triangle is to be filled with */
+    Uint32 fillcolor;
+};
+
+typedef struct transform transform_t;
+
+/*
+ * Per-draw state shared by all triangles of an object.
+ */
+struct transform {
+    float scale;            /* Scale factor */
+    float matrix[2][2];     /* Rotation matrix, set by transform_setrotation */
+    int tx, ty;             /* On-screen position of the model origin */
+    const Uint32 *palette;  /* Model palette that color indices refer to */
+};
+
+/*
+ * Set the transform's rotation matrix to turn by the given number of
+ * degrees. Done once per object, so no triangle pays for sin and cos.
+ */
+void transform_setrotation(transform_t *transform, float degrees);
+
+/*
+ * Transform a model triangle to screen space, writing the result to out.
+ */
+void transform_triangle(const modeltri_t *triangle, const transform_t *transform, screentri_t *out);
+
+/*
+ * Draw a filled screen-space triangle on the given surface, counting the
+ * work in stats unless it is NULL. Nothing is checked: every corner must
+ * lie on the surface, as it does for objects wholly inside it.
+ */
+void fill_screentriangle(SDL_Surface *surface, screentri_t *triangle, renderstats_t *stats);
+
+/*
+ * Draw the outline of a screen-space triangle in its fill color, like
+ * fill_screentriangle for TRIANGLE_WIREFRAME. Every corner must lie on the
+ * surface.
+ */
+void wire_screentriangle(SDL_Surface *surface, screentri_t *triangle, renderstats_t *stats);
+
+/*
+ * Draw a screen-space triangle with the given rasterizer (TRIANGLE_FILLED
+ * or TRIANGLE_WIREFRAME), clipped to the surface. A triangle wholly
+ * outside the surface is culled. One wholly on it comes out the same as
+ * from fill_screentriangle or wire_screentriangle.
+ */
+void draw_clippedtriangle(SDL_Surface *surface, screentri_t *triangle, int rasterizer,
+                          renderstats_t *stats);
+
 /*
- * Draw a filled triangle on the given surface
+ * Draw a filled triangle on the given surface. A triangle with a corner
+ * off the surface is reported on stdout and not drawn.
  */
 void draw_triangle(SDL_Surface *surface, triangle_t *triangle);
 
@@ -0,0 +1,164 @@
+/*
+ * Worker pool module: splitting a range of items across threads.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "workers.h"
+#include "trace.h"
+
+typedef struct worker worker_t;
+
+/* One pool thread and the semaphore that starts it */
+struct worker {
+    workers_t   *pool;
+    int         index;
+    SDL_sem     *start;
+    SDL_Thread  *thread;
+};
+
+struct workers {
+    int             numthreads;
+    worker_t        threads[WORKERS_MAX];   /* Slot 0 is the caller */
+    SDL_sem         *done;                  /* Posted once per finished slice */
+    int             quit;
+
+    /* The current job; written before the start semaphores are posted */
+    workers_fn_t    fn;
+    void            *arg;
+    int             count;
+};
+
+/* Run this worker's slice of the current job. */
+static void run_slice(workers_t *pool, int index)
+{
+    int begin = (int)((long long)pool->count * index / pool->numthreads);
+    int end = (int)((long long)pool->count * (index + 1) / pool->numthreads);
+
+    if (begin < end) {
+        TRACE_BEGIN(start);
+        pool->fn(pool->arg, begin, end, index);
+        TRACE_END("worker slice", start);
+    }
+}
+
+/* Pool thread: wait for a job, run a slice of it, report back. */
+static int worker_main(void *data)
+{
+    worker_t *worker = data;
+    workers_t *pool = worker->pool;
+    char name[32];
+
+    snprintf(name, sizeof(name), "worker %d", worker->index);
+    trace_threadname(name);
+
+    for (;;) {
+        SDL_SemWait(worker->start);
+        if (pool->quit) {
+            break;
+        }
+        run_slice(pool, worker->index);
+        SDL_SemPost(pool->done);
+    }
+
+    return 0;
+}
+
+/* Return a newly created pool of numthreads threads, counting the caller. */
+workers_t *workers_create(int numthreads)
+{
+    workers_t *pool;
+    int i;
+
+    if (numthreads < 1 || numthreads > WORKERS_MAX) {
+        return NULL;
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->numthreads = 1;
+    pool->done = SDL_CreateSemaphore(0);
+    if (!pool->done) {
+        free(pool);
+        return NULL;
+    }
+
+    /* numthreads only counts threads that started, so destroy can clean up midway */
+    for (i = 1; i < numthreads; i++) {
+        worker_t *worker = &pool->threads[i];
+
+        worker->pool = pool;
+        worker->index = i;
+        worker->start = SDL_CreateSemaphore(0);
+        if (!worker->start) {
+            break;
+        }
+        worker->thread = SDL_CreateThread(worker_main, "worker", worker);
+        if (!worker->thread) {
+            SDL_DestroySemaphore(worker->start);
+            break;
+        }
+        pool->numthreads++;
+    }
+    if (pool->numthreads != numthreads) {
+        fprintf(stderr, "Unable to start worker thread. Error returned: %s\n", SDL_GetError());
+        workers_destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+/* Stop the threads and free the pool. */
+void workers_destroy(workers_t *workers)
+{
+    int i;
+
+    if (!workers) {
+        return;
+    }
+
+    workers->quit = 1;
+    for (i = 1; i < workers->numthreads; i++) {
+        SDL_SemPost(workers->threads[i].start);
+        SDL_WaitThread(workers->threads[i].thread, NULL);
+        SDL_DestroySemaphore(workers->threads[i].start);
+    }
+
+    SDL_DestroySemaphore(workers->done);
+    free(workers);
+}
+
+/* Return the number of threads in the pool, counting the caller. */
+int workers_count(workers_t *workers)
+{
+    return workers ? workers->numthreads : 1;
+}
+
+/* Run fn over items [0, count) split across the pool. */
+void workers_run(workers_t *workers, int count, workers_fn_t fn, void *arg)
+{
+    int i;
+
+    if (!workers || count <= 0) {
+        if (count > 0) {
+            fn(arg, 0, count, 0);
+        }
+        return;
+    }
+
+    workers->fn = fn;
+    workers->arg = arg;
+    workers->count = count;
+
+    for (i = 1; i < workers->numthreads; i++) {
+        SDL_SemPost(workers->threads[i].start);
+    }
+    run_slice(workers, 0);
+    for (i = 1; i < workers->numthreads; i++) {
+        SDL_SemWait(workers->done);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef WORKERS_H_
+#define WORKERS_H_
+
+/*
+ * Worker pool interface
+ *
+ * A fixed set of threads that split a range of items between them. The
+ * calling thread works on a share of the range too, so a pool of N
+ * threads starts N - 1 of its own, and a pool of one runs everything
+ * inline. Each thread gets one contiguous slice, so work must not depend
+ * on how the range is divided.
+ */
+
+struct workers;
+typedef struct workers workers_t;
+
+/* Maximum number of threads in a pool */
+#define WORKERS_MAX     64
+
+/*
+ * Process items [begin, end). worker is the index of the thread, from 0
+ * (the caller) to workers_count() - 1.
+ */
+typedef void (*workers_fn_t)(void *arg, int begin, int end, int worker);
+
+/*
+ * Return a newly created pool of numthreads threads, counting the caller.
+ * Returns NULL on error.
+ */
+workers_t *workers_create(int numthreads);
+
+/*
+ * Stop the threads and free the pool.
+ */
+void workers_destroy(workers_t *workers);
+
+/*
+ * Return the number of threads in the pool, counting the caller.
+ */
+int workers_count(workers_t *workers);
+
+/*
+ * Run fn over items [0, count) split across the pool, and return when
+ * every slice is done.
+ */
+void workers_run(workers_t *workers, int count, workers_fn_t fn, void *arg);
+
+#endif /*WORKERS_H_*/